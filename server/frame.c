@@ -0,0 +1,246 @@
+/*
+ * frame.c - implementation file for frame module
+ *
+ * frame_draw is a copy and a few stores. The pool
+ * cuts its jobs into blocks that the workers and the caller take one at
+ * a time under the pool's lock, so a single huge frame is shared out as
+ * well as many small ones.
+ * See frame.h for more information.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "frame.h"
+
+/**************** global types ****************/
+typedef struct framePool {
+    int workers;
+    pthread_t* threads;
+    pthread_mutex_t lock;       // guards everything below
+    pthread_cond_t wake;        // signalled when there are blocks to take, or on stop
+    pthread_cond_t done;        // signalled when the last block is finished
+    bool stopping;
+
+    const frameJob_t* jobs;     // the frame_drawAll going on, if any
+    int count;
+    int job;                    // next block to take: job, and cell in it
+    int offset;
+    int unfinished;             // blocks taken or not, and not done yet
+} framePool_t;
+
+/**************** file-local global variables ****************/
+static const int MAX_WORKERS = 7;
+static const int BLOCK_CELLS = 16384;       // cells per block a thread takes
+static const int PARALLEL_MIN = 65536;      // fewer cells than this are done by the caller alone
+
+/**************** local functions ****************/
+static void* workerMain(void* arg);
+static const frameJob_t* takeBlock(framePool_t* pool, int* from, int* length);
+static void drawBlock(const frameJob_t* job, int from, int length);
+
+
+/**************** frame_draw ****************/
+/* Copy the background and draw the sprites on it.
+ * See frame.h for more information. */
+void frame_draw(char* out, const char* background, int length, const sprite_t* sprites, int count)
+{
+    if (out == NULL || background == NULL || length <= 0){
+        return;
+    }
+    frameJob_t job = {out, background, length, sprites, count};
+    drawBlock(&job, 0, length);
+}
+
+
+/**************** frame_newPool ****************/
+/* Start a pool of workers.
+ * See frame.h for more information. */
+framePool_t* frame_newPool(int workers)
+{
+    if (workers < 0){
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (cpus > 1) ? (int)cpus - 1 : 0;
+    }
+    if (workers > MAX_WORKERS){
+        workers = MAX_WORKERS;
+    }
+
+    framePool_t* pool = calloc(1, sizeof(framePool_t));
+    if (pool == NULL){
+        return NULL;
+    }
+    pool->threads = calloc(workers > 0 ? workers : 1, sizeof(pthread_t));
+    if (pool->threads == NULL){
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    // as many as will start; the caller works too, so fewer is only slower
+    for (int i = 0; i < workers; i++){
+        if (pthread_create(&pool->threads[i], NULL, workerMain, pool) != 0){
+            break;
+        }
+        pool->workers++;
+    }
+    return pool;
+}
+
+
+/**************** frame_poolWorkers ****************/
+/* Return the number of workers.
+ * See frame.h for more information. */
+int frame_poolWorkers(framePool_t* pool)
+{
+    return (pool == NULL) ? 0 : pool->workers;
+}
+
+
+/**************** frame_drawAll ****************/
+/* Draw every job, sharing the blocks with the workers.
+ * See frame.h for more information. */
+void frame_drawAll(framePool_t* pool, const frameJob_t* jobs, int count)
+{
+    if (jobs == NULL || count <= 0){
+        return;
+    }
+    long cells = 0;
+    int blocks = 0;
+    for (int i = 0; i < count; i++){
+        if (jobs[i].length > 0){
+            cells += jobs[i].length;
+            blocks += (jobs[i].length + BLOCK_CELLS - 1) / BLOCK_CELLS;
+        }
+    }
+
+    // waking the workers costs more than a few frames do
+    if (pool == NULL || pool->workers == 0 || cells < PARALLEL_MIN){
+        for (int i = 0; i < count; i++){
+            frame_draw(jobs[i].out, jobs[i].background, jobs[i].length, jobs[i].sprites, jobs[i].count);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->jobs = jobs;
+    pool->count = count;
+    pool->job = 0;
+    pool->offset = 0;
+    pool->unfinished = blocks;
+    pthread_cond_broadcast(&pool->wake);
+
+    const frameJob_t* job;
+    int from, length;
+    while ((job = takeBlock(pool, &from, &length)) != NULL){
+        pthread_mutex_unlock(&pool->lock);
+        drawBlock(job, from, length);
+        pthread_mutex_lock(&pool->lock);
+        pool->unfinished--;
+    }
+    while (pool->unfinished > 0){
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pool->jobs = NULL;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+
+/**************** frame_deletePool ****************/
+/* Stop the workers and free the pool.
+ * See frame.h for more information. */
+void frame_deletePool(framePool_t* pool)
+{
+    if (pool == NULL){
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->workers; i++){
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool);
+}
+
+
+/**************** workerMain ****************/
+/* Worker thread: take blocks and draw them until told to stop. */
+static void* workerMain(void* arg)
+{
+    framePool_t* pool = arg;
+    const frameJob_t* job;
+    int from, length;
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stopping){
+        if ((job = takeBlock(pool, &from, &length)) == NULL){
+            pthread_cond_wait(&pool->wake, &pool->lock);
+            continue;
+        }
+        // draw without holding the lock, so the others can take blocks
+        pthread_mutex_unlock(&pool->lock);
+        drawBlock(job, from, length);
+        pthread_mutex_lock(&pool->lock);
+
+        if (--pool->unfinished == 0){
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+
+/**************** takeBlock ****************/
+/* Return the job of the next block of cells to draw, and set from and
+ * length to the block; NULL if there are none left. Caller holds the lock. */
+static const frameJob_t* takeBlock(framePool_t* pool, int* from, int* length)
+{
+    if (pool->jobs == NULL){
+        return NULL;
+    }
+    while (pool->job < pool->count && pool->offset >= pool->jobs[pool->job].length){
+        pool->job++;
+        pool->offset = 0;
+    }
+    if (pool->job == pool->count){
+        return NULL;
+    }
+    const frameJob_t* job = &pool->jobs[pool->job];
+    int left = job->length - pool->offset;
+    *from = pool->offset;
+    *length = (left < BLOCK_CELLS) ? left : BLOCK_CELLS;
+    pool->offset += BLOCK_CELLS;
+    return job;
+}
+
+
+/**************** drawBlock ****************/
+/* Draw cells [from, from + length) of job: the background, then the
+ * sprites that fall there. */
+static void drawBlock(const frameJob_t* job, int from, int length)
+{
+    memcpy(job->out + from, job->background + from, length);
+    for (int i = 0; i < job->count; i++){
+        int loc = job->sprites[i].loc;
+        if (loc >= from && loc < from + length){
+            job->out[loc] = job->sprites[i].c;
+        }
+    }
+}
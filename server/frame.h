@@ -0,0 +1,92 @@
+/*
+ * frame.h - header file for frame module
+ *
+ * Draws what a player sees in one pass over the map: every cell they
+ * remember (placesSeen), with the gold and players they can see right
+ * now on top, and '@' where they stand. The caller knows where the few
+ * things that move are, so frame_draw copies the background (what the
+ * player remembers) and puts a short list of sprites (gold, players, '@')
+ * on it: a whole frame costs about as much as copying it, and changing
+ * the sprites costs nothing but the sprites. Many frames at once can be
+ * drawn on a small pool of worker threads.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#ifndef __FRAME_H
+#define __FRAME_H
+
+#include <stdio.h>
+
+/**************** global types ****************/
+typedef struct framePool framePool_t;  // opaque to users of the module
+
+// One char drawn over the background, at cell loc of the frame
+typedef struct sprite {
+    int loc;
+    char c;
+} sprite_t;
+
+// One frame for frame_drawAll: the arguments of a frame_draw call
+typedef struct frameJob {
+    char* out;
+    const char* background;
+    int length;
+    const sprite_t* sprites;
+    int count;
+} frameJob_t;
+
+
+/**************** functions ****************/
+
+/**************** frame_draw ****************/
+/* Fill out[0, length) with background, then draw each of sprites[0,
+ * count) at its cell, in order (a later one covers an earlier one).
+ *
+ * Notes:
+ *   sprites outside [0, length) are ignored
+ */
+void frame_draw(char* out, const char* background, int length, const sprite_t* sprites, int count);
+
+
+/**************** frame_newPool ****************/
+/* Create a pool of worker threads for frame_drawAll; return it, or
+ * NULL if it cannot be made.
+ *
+ * Notes:
+ *   workers < 0 means one per CPU beyond the caller's, up to 7; 0 is a
+ *     pool that does everything on the calling thread
+ *   the workers sleep until frame_drawAll has work for them
+ */
+framePool_t* frame_newPool(int workers);
+
+
+/**************** frame_poolWorkers ****************/
+/* Return how many worker threads pool has (0 if pool is NULL). */
+int frame_poolWorkers(framePool_t* pool);
+
+
+/**************** frame_drawAll ****************/
+/* Do every job in jobs[0, count), as frame_draw would, and return once
+ * they are all done.
+ *
+ * Notes:
+ *   the jobs must not overlap one another's out
+ *   pool may be NULL; with no workers, or too little work to be worth
+ *     waking them, the jobs are done on the calling thread
+ *   not to be called from two threads at once with the same pool
+ *
+ * cut the jobs into blocks of cells and wake the workers
+ * take blocks and draw them along with the workers: the block of the
+ *   background, then the job's sprites that fall in it
+ * wait until the last block is done
+ */
+void frame_drawAll(framePool_t* pool, const frameJob_t* jobs, int count);
+
+
+/**************** frame_deletePool ****************/
+/* Stop and join the workers, and free pool; NULL is ignored. */
+void frame_deletePool(framePool_t* pool);
+
+#endif // __FRAME_H
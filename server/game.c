@@ -0,0 +1,1531 @@
+/*
+ * game.c - implementation file for game module
+ *
+ * The player table, occupancy grid and seen matrix, and every rule of
+ * the game, with messages going out through the sink.
+ * See game.h for more information.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "game.h"
+#include "grid.h"
+#include "gold.h"
+#include "moves.h"
+#include "rng.h"
+#include "visibility.h"
+#include "frame.h"
+
+/**************** file-local global variables ****************/
+static const int GOLD_TOTAL = 250;          // amount of gold game has
+static const int GOLD_MIN_NUM_PILES = 10;   // minmimum gold piles
+static const int GOLD_MAX_NUM_PILES = 30;   // maximum gold piles
+#define TICK_MAX_KEYS 8                     // keys a player can queue for one tick
+#define DISPLAY_PREFIX "DISPLAY\n"
+#define DISPLAY_PREFIX_LEN 8
+#define REDRAW_RATIO 16                     // a frame costs as much to redraw whole as 1/16 of it patched
+
+/**************** local types ****************/
+// The parts of a player that are only needed to draw their map or the final scores.
+// frame is the DISPLAY message as the player last got it; every change to
+// one of their maps patches the cells it touched, so sending it costs nothing.
+// Drawn whole, it is placesSeen (the background) with a few sprites on
+// top: the gold in view, the players in view and themselves. gold keeps
+// the first of those, so no layer has to be scanned to find them
+typedef struct player {
+    char* name;
+    char playerChar;
+    grid_t* visibleMap;
+    grid_t* placesSeen;
+    char* frame;        // DISPLAY_PREFIX, then what the player sees at each cell
+    int* lit;           // the cells of visibleMap that are not blank
+    int numLit;
+    int* gold;          // the cells of visibleMap with gold on
+    int numGold;
+    sprite_t* sprites;  // room to list every sprite, to draw frame whole
+    int drawnAt;        // the cell frame has the '@' at, or -1
+    int viewRows;       // viewport size, or 0 for the whole map
+    int viewCols;
+    char* window;       // the viewport frame, cut from frame when sent
+} player_t;
+
+// Every player, by slot (playerChar - 'A'), as a structure of arrays:
+// what a move or a broadcast reads sits in its own dense array, and the
+// rest of each player is in players[slot]. Slots 0 to count - 1 are in use;
+// a player who quits keeps their slot, and gets it back if they rejoin.
+// active lists the slots of players still in the game, in slot order;
+// everything run per move or per frame loops over it, so players who quit
+// cost nothing. A quitter keeps only their name and purse, for the
+// scoreboard: their maps are freed and their cell is left empty.
+//
+// Bit j of canSee[i] is set iff player i currently sees player j,
+// so a move only has to touch the mover's row and column.
+// occupants is the same idea per cell of the map: bit j of occupants[loc]
+// is set iff active player j stands at loc. Sprints can run over other
+// players, so a cell can hold more than one; the lowest slot is "the"
+// player there, for swaps and for drawing.
+typedef struct playerTable {
+    int count;                              // slots in use
+    int active[GAME_MAX_PLAYERS];           // slots of active players, ascending
+    int numActive;
+    int location[GAME_MAX_PLAYERS];
+    int purse[GAME_MAX_PLAYERS];            // gold picked up
+    bool isActive[GAME_MAX_PLAYERS];
+    uint32_t canSee[GAME_MAX_PLAYERS];      // one row of bits per slot
+    player_t players[GAME_MAX_PLAYERS];
+    uint32_t* occupants;                    // one mask of slots per cell of the map
+    int pickedUp[GAME_MAX_PLAYERS];         // gold picked up since the last GOLD message
+} playerTable_t;
+
+// What spectators are sent instead of the whole map, if anything: an
+// overview with one cell per scale x scale block of it, and/or a region
+// of it at full detail. The overview is patched block by block as the
+// spectator's frame changes; the region is cut from that frame when sent.
+typedef struct spectatorView {
+    int scale;          // 1 for no overview
+    int rows;           // size of the overview
+    int cols;
+    char* overview;     // "OVERVIEW scale\n", then the overview
+    int headerLen;
+    int top;            // the region, if regionRows > 0
+    int left;
+    int regionRows;
+    int regionCols;
+    char* region;       // its DISPLAY, cut when sent
+} spectatorView_t;
+
+/**************** global types ****************/
+typedef struct game {
+    grid_t* map;                                // the whole map, gold included
+    gold_t* gold;
+    moves_t* moves;
+    visibility_t* vis;
+    rng_t* rng;                                 // for spawn points
+    playerTable_t table;
+    char keys[GAME_MAX_PLAYERS][TICK_MAX_KEYS]; // keys queued by each player, in order
+    int numKeys[GAME_MAX_PLAYERS];
+    bool frameDue;                              // something changed since the last frame
+    uint32_t dirty;                             // bit per slot: their frame changed since they were sent it
+    uint32_t held;                              // bit per slot: not sent frames for now (game_hold)
+    uint32_t redraw;                            // bit per slot: frame to be drawn whole before it is sent
+    framePool_t* pool;                          // threads to draw them on (game_frameThreads), or NULL
+    bool spectating;                            // spectators get frames too
+    char* spectatorFrame;                       // the spectator's DISPLAY, patched as players move and gold goes
+    bool spectatorDirty;
+    bool spectatorHeld;
+    spectatorView_t view;                       // an overview and region instead, for huge maps
+    long frames;                                // frames flushed to a sink, with a DISPLAY sent
+    long displaysSent;                          // player DISPLAYs sent in them ...
+    long displaysSkipped;                       // ... and not sent, since nothing in view changed
+    long displaysHeld;                          // ... and held back, for a later frame to supersede
+    long displayBytes;                          // in the DISPLAYs sent
+    long redraws;                               // frames drawn whole instead of patched
+    game_sink_t sink;
+    void* sinkArg;
+} game_t;
+
+/**************** local functions ****************/
+static void emit(game_t* game, int slot, gameMessage_t type, const char* message);
+static void sendJoined(game_t* game, int slot);
+static bool applyKey(game_t* game, int slot, char key);
+static void sprint(game_t* game, int slot, int direction);
+static void updateGold(game_t* game, int slot, int loc);
+static void updateVisibility(game_t* game, int slot);
+static void rememberVisibility(game_t* game, int slot, int loc);
+static void clearGoldSightings(game_t* game, int pickerSlot, int loc);
+static void changeAllVisibleMaps(game_t* game, int slot, int oldLoc, int newLoc);
+static void updateSeenRow(game_t* game, int slot);
+static void updateSeenColumn(game_t* game, int movedSlot, int oldLoc);
+static int swapPlayerLocation(game_t* game, int slot, int oldLoc, int newLoc);
+static void moveOccupant(game_t* game, int slot, int oldLoc, int newLoc);
+static int playerAt(playerTable_t* table, int loc, int exceptSlot);
+static int randomFloor(game_t* game);
+static void activatePlayer(playerTable_t* table, int slot);
+static void retirePlayer(game_t* game, int slot);
+static bool newMaps(game_t* game, player_t* player);
+static void freeMaps(player_t* player);
+static void patchCell(game_t* game, int slot, int loc);
+static void redrawFrame(game_t* game, int slot);
+static void composeFrames(game_t* game);
+static int listSprites(game_t* game, int slot);
+static void patchSpectator(game_t* game, int loc);
+static void sendGold(game_t* game);
+static void sendDisplay(game_t* game, int slot);
+static const char* cutWindow(game_t* game, int slot);
+static bool sendSpectatorDisplay(game_t* game);
+static void sendSpectatorView(game_t* game, int target);
+static void patchOverview(game_t* game, int loc);
+static int detail(char c);
+static void cutRegion(char* out, const char* map, int stride, int top, int left, int rows, int cols);
+
+
+/**************** game_new ****************/
+/* Start a game on map.
+ * See game.h for more information. */
+game_t* game_new(grid_t* map, uint64_t seed, int radius, game_sink_t sink, void* sinkArg)
+{
+    // validate parameters
+    if (map == NULL || grid_getMap(map) == NULL){
+        fprintf(stderr, "Error: NULL map in game_new\n");
+        return NULL;
+    }
+
+    game_t* game = calloc(1, sizeof(game_t));
+    if (game == NULL){
+        fprintf(stderr, "Error: issue allocating memory in game_new\n");
+        return NULL;
+    }
+    game->map = map;
+    game->sink = sink;
+    game->sinkArg = sinkArg;
+
+    // this game's own random numbers: the same seed gives the same game
+    game->rng = rng_new(seed);
+    if (game->rng == NULL){
+        game_delete(game);
+        return NULL;
+    }
+
+    game->gold = gold_new(map, game->rng, GOLD_MIN_NUM_PILES, GOLD_MAX_NUM_PILES, GOLD_TOTAL);
+    if (game->gold == NULL){
+        fprintf(stderr, "Error: could not generate gold in map\n");
+        game_delete(game);
+        return NULL;
+    }
+
+    // every step and sprint on this map, looked up instead of walked
+    game->moves = moves_new(map);
+    game->vis = visibility_new(map, radius);
+
+    // no players, nobody sees anybody, nobody on the map
+    game->table.occupants = calloc(grid_getLength(map) + 1, sizeof(uint32_t));
+    game->spectatorFrame = malloc(DISPLAY_PREFIX_LEN + grid_getLength(map) + 1);
+    if (game->moves == NULL || game->vis == NULL || game->table.occupants == NULL ||
+        game->spectatorFrame == NULL){
+        fprintf(stderr, "Error: could not set up the game in game_new\n");
+        game_delete(game);
+        return NULL;
+    }
+
+    // the spectator sees the whole map, gold and all; players are patched in as they come
+    memcpy(game->spectatorFrame, DISPLAY_PREFIX, DISPLAY_PREFIX_LEN);
+    memcpy(game->spectatorFrame + DISPLAY_PREFIX_LEN, grid_getMap(map), grid_getLength(map) + 1);
+    game->view.scale = 1;
+    return game;
+}
+
+
+/**************** game_visibility ****************/
+/* Return the game's visibility object.
+ * See game.h for more information. */
+visibility_t* game_visibility(game_t* game)
+{
+    return (game == NULL) ? NULL : game->vis;
+}
+
+
+/**************** game_frameThreads ****************/
+/* Draw whole frames on a new pool of workers threads.
+ * See game.h for more information. */
+bool game_frameThreads(game_t* game, int workers)
+{
+    if (game == NULL){
+        return false;
+    }
+    frame_deletePool(game->pool);
+    game->pool = frame_newPool(workers);
+    return game->pool != NULL;
+}
+
+
+/**************** game_join ****************/
+/* Add a new player called name.
+ * See game.h for more information. */
+int game_join(game_t* game, const char* name)
+{
+    if (game == NULL || name == NULL || game->table.count >= GAME_MAX_PLAYERS){
+        return -1;
+    }
+    playerTable_t* table = &game->table;
+    int slot = table->count;
+    player_t* player = &table->players[slot];
+
+    // duplicate so no bad pointer
+    char* nameCopy = malloc(strlen(name) + 1);
+    if (nameCopy == NULL){
+        return -1;
+    }
+    strcpy(nameCopy, name);
+
+    int startingLocation = randomFloor(game);
+
+    if (!newMaps(game, player)){
+        free(nameCopy);
+        return -1;
+    }
+
+    // fills in player attributes
+    player->name = nameCopy;
+    player->playerChar = 'A' + slot;
+    table->isActive[slot] = true;
+    table->purse[slot] = 0;
+    table->location[slot] = startingLocation;
+    table->canSee[slot] = 0;
+
+    // claim the slot and the player's cell
+    table->count++;
+    activatePlayer(table, slot);
+    moveOccupant(game, slot, -1, startingLocation);
+    sendJoined(game, slot);
+    return slot;
+}
+
+
+/**************** game_rejoin ****************/
+/* Bring back the player in slot, who quit.
+ * See game.h for more information. */
+int game_rejoin(game_t* game, int player, const char* name)
+{
+    if (game == NULL || name == NULL || player < 0 || player >= game->table.count ||
+        game->table.isActive[player]){
+        return -1;
+    }
+    playerTable_t* table = &game->table;
+
+    // copy name otherwise bad pointer reference
+    char* nameCopy = malloc(strlen(name) + 1);
+    if (nameCopy == NULL){
+        return -1;
+    }
+    strcpy(nameCopy, name);
+
+    // their maps were freed when they quit
+    player_t* existingPlayer = &table->players[player];
+    if (!newMaps(game, existingPlayer)){
+        free(nameCopy);
+        return -1;
+    }
+    free(existingPlayer->name);
+    existingPlayer->name = nameCopy;
+    table->purse[player] = 0;
+
+    // back on the board where they left it, unless somebody has moved onto it since
+    if (table->occupants[table->location[player]] != 0){
+        table->location[player] = randomFloor(game);
+    }
+    table->isActive[player] = true;
+    table->canSee[player] = 0;
+    activatePlayer(table, player);
+    moveOccupant(game, player, -1, table->location[player]);
+    sendJoined(game, player);
+    return player;
+}
+
+
+/**************** game_numPlayers ****************/
+/* Return the number of players who have ever joined.
+ * See game.h for more information. */
+int game_numPlayers(game_t* game)
+{
+    return (game == NULL) ? 0 : game->table.count;
+}
+
+
+/**************** game_isActive ****************/
+/* Return true if player has joined and not quit.
+ * See game.h for more information. */
+bool game_isActive(game_t* game, int player)
+{
+    return game != NULL && player >= 0 && player < game->table.count && game->table.isActive[player];
+}
+
+
+/**************** game_spectate ****************/
+/* Start or stop sending spectators a full view.
+ * See game.h for more information. */
+void game_spectate(game_t* game, bool watching)
+{
+    if (game == NULL){
+        return;
+    }
+    game->spectating = watching;
+    if (watching && game->sink != NULL){
+        char gridMessage[32];
+        snprintf(gridMessage, sizeof(gridMessage), "GRID %d %d", grid_getHeight(game->map), grid_getWidth(game->map));
+        emit(game, GAME_NEW_SPECTATOR, GAME_MSG_GRID, gridMessage);
+        sendSpectatorView(game, GAME_NEW_SPECTATOR);
+    }
+}
+
+
+/**************** game_spectatorOverview ****************/
+/* Send spectators an overview of the map instead of the whole of it.
+ * See game.h for more information. */
+bool game_spectatorOverview(game_t* game, int scale)
+{
+    if (game == NULL || scale < 1){
+        return false;
+    }
+    spectatorView_t* view = &game->view;
+    free(view->overview);
+    view->overview = NULL;
+    view->scale = 1;
+
+    if (scale > 1){
+        int height = grid_getHeight(game->map);
+        int width = grid_getWidth(game->map);
+        int rows = (height + scale - 1) / scale;
+        int cols = (width + scale - 1) / scale;
+        view->overview = malloc(GAME_WINDOW_HEADER_MAX + (size_t)rows * (cols + 1) + 1);
+        if (view->overview == NULL){
+            return false;
+        }
+        view->scale = scale;
+        view->rows = rows;
+        view->cols = cols;
+        view->headerLen = snprintf(view->overview, GAME_WINDOW_HEADER_MAX, "OVERVIEW %d\n", scale);
+        char* row = view->overview + view->headerLen;
+        for (int r = 0; r < rows; r++){
+            row[r * (cols + 1) + cols] = '\n';
+        }
+        row[rows * (cols + 1)] = '\0';
+
+        // draw every block once; from here on only changed ones are
+        int stride = width + 1;
+        for (int r = 0; r < rows; r++){
+            for (int c = 0; c < cols; c++){
+                patchOverview(game, r * scale * stride + c * scale);
+            }
+        }
+    }
+    game->spectatorDirty = true;
+    game->frameDue = true;
+    return true;
+}
+
+
+/**************** game_spectatorRegion ****************/
+/* Send spectators one region of the map at full detail.
+ * See game.h for more information. */
+bool game_spectatorRegion(game_t* game, int top, int left, int rows, int cols)
+{
+    int height = (game == NULL) ? 0 : grid_getHeight(game->map);
+    int width = (game == NULL) ? 0 : grid_getWidth(game->map);
+    if (game == NULL || rows < 0 || cols < 0 ||
+        ((rows > 0 && cols > 0) && (top < 0 || left < 0 || top >= height || left >= width))){
+        return false;
+    }
+    spectatorView_t* view = &game->view;
+    free(view->region);
+    view->region = NULL;
+    view->regionRows = 0;
+    view->regionCols = 0;
+
+    if (rows > 0 && cols > 0){
+        // cut off at the edges of the map (compared, not added, so huge sizes cannot overflow)
+        rows = (rows < height - top) ? rows : height - top;
+        cols = (cols < width - left) ? cols : width - left;
+        view->region = malloc(GAME_WINDOW_HEADER_MAX + (size_t)rows * (cols + 1) + 1);
+        if (view->region == NULL){
+            return false;
+        }
+        view->top = top;
+        view->left = left;
+        view->regionRows = rows;
+        view->regionCols = cols;
+    }
+    game->spectatorDirty = true;
+    game->frameDue = true;
+    return true;
+}
+
+
+/**************** game_viewport ****************/
+/* Send player only the window of their map around them.
+ * See game.h for more information. */
+bool game_viewport(game_t* game, int player, int rows, int cols)
+{
+    if (game == NULL || player < 0 || player >= game->table.count || !game->table.isActive[player] ||
+        rows < 0 || cols < 0){
+        return false;
+    }
+    player_t* p = &game->table.players[player];
+    free(p->window);
+    p->window = NULL;
+    p->viewRows = 0;
+    p->viewCols = 0;
+
+    // a window at least as big as the map is the whole map
+    int height = grid_getHeight(game->map);
+    int width = grid_getWidth(game->map);
+    if (rows > 0 && cols > 0 && (rows < height || cols < width)){
+        rows = rows < height ? rows : height;
+        cols = cols < width ? cols : width;
+        p->window = malloc(GAME_WINDOW_HEADER_MAX + (size_t)rows * (cols + 1) + 1);
+        if (p->window == NULL){
+            return false;
+        }
+        p->viewRows = rows;
+        p->viewCols = cols;
+    }
+
+    // their next frame is in the new form, whether or not anything moved
+    game->dirty |= (uint32_t)1 << player;
+    game->frameDue = true;
+    return true;
+}
+
+
+/**************** game_hold ****************/
+/* Hold back player's frames, or let them go again.
+ * See game.h for more information. */
+void game_hold(game_t* game, int player, bool hold)
+{
+    if (game == NULL){
+        return;
+    }
+    if (player == GAME_SPECTATOR){
+        game->spectatorHeld = hold;
+    }
+    else if (player >= 0 && player < GAME_MAX_PLAYERS){
+        uint32_t bit = (uint32_t)1 << player;
+        game->held = hold ? (game->held | bit) : (game->held & ~bit);
+    }
+}
+
+
+/**************** game_step ****************/
+/* Apply one key from player right away.
+ * See game.h for more information. */
+bool game_step(game_t* game, int player, char key)
+{
+    if (!game_isActive(game, player)){
+        return game_over(game);
+    }
+    if (key == 'Q' || key == 'q'){
+        // they leave the game (and drop any keys they queued)
+        retirePlayer(game, player);
+        emit(game, player, GAME_MSG_QUIT, "QUIT Thanks for playing!");
+    }
+    else if (applyKey(game, player, key)){
+        game->frameDue = true;
+    }
+    return game_over(game);
+}
+
+
+/**************** game_queue ****************/
+/* Queue a key from player for the next game_tick.
+ * See game.h for more information. */
+bool game_queue(game_t* game, int player, char key)
+{
+    if (!game_isActive(game, player)){
+        return true;
+    }
+    if (key == 'Q' || key == 'q'){
+        game_step(game, player, key);
+        return true;
+    }
+    if (game->numKeys[player] >= TICK_MAX_KEYS){
+        return false;
+    }
+    game->keys[player][game->numKeys[player]++] = key;
+    return true;
+}
+
+
+/**************** game_tick ****************/
+/* Apply the queued keys round robin, then game_flush.
+ * See game.h for more information. */
+bool game_tick(game_t* game)
+{
+    if (game == NULL){
+        return false;
+    }
+    playerTable_t* table = &game->table;
+
+    // everyone's first key, then everyone's second key, ...
+    // so the order depends only on what was queued, never on arrival times
+    for (int round = 0; round < TICK_MAX_KEYS; round++){
+        for (int i = 0; i < table->numActive; i++){
+            int slot = table->active[i];
+            if (round < game->numKeys[slot] && applyKey(game, slot, game->keys[slot][round])){
+                game->frameDue = true;
+            }
+        }
+    }
+    for (int slot = 0; slot < table->count; slot++){
+        game->numKeys[slot] = 0;
+    }
+    game_flush(game);
+    return game_over(game);
+}
+
+
+/**************** game_flush ****************/
+/* Send the frame, if anything changed since the last one.
+ * See game.h for more information. */
+void game_flush(game_t* game)
+{
+    if (game == NULL || !game->frameDue){
+        return;
+    }
+    game->frameDue = false;
+    sendGold(game);
+    if (game->sink == NULL){
+        return;
+    }
+    // only players whose view changed are sent a DISPLAY
+    long sentBefore = game->displaysSent;
+    composeFrames(game);
+    for (int i = 0; i < game->table.numActive; i++){
+        sendDisplay(game, game->table.active[i]);
+    }
+    bool spectatorSent = game->spectating && sendSpectatorDisplay(game);
+
+    // a frame counts only if somebody was sent it, not if it was all held back
+    if (game->displaysSent > sentBefore || spectatorSent){
+        game->frames++;
+    }
+
+    // a held frame goes out with the first flush after it is let go
+    game->frameDue = (game->dirty & game->held) != 0 ||
+                     (game->spectating && game->spectatorDirty && game->spectatorHeld);
+}
+
+
+/**************** game_over ****************/
+/* Return true if all the gold has been picked up.
+ * See game.h for more information. */
+bool game_over(game_t* game)
+{
+    return game != NULL && gold_remaining(game->gold) == 0;
+}
+
+
+/**************** game_end ****************/
+/* Send the final scores.
+ * See game.h for more information. */
+void game_end(game_t* game)
+{
+    if (game == NULL || game->sink == NULL){
+        return;
+    }
+    playerTable_t* table = &game->table;
+
+    // a header, then every player who ever joined, in slot order
+    char message[2048];
+    strcpy(message, "QUIT GAME OVER:\n");
+    for (int slot = 0; slot < table->count; slot++){
+        player_t* player = &table->players[slot];
+        char line[100];
+        snprintf(line, sizeof(line), "%c %10d %s\n", player->playerChar, table->purse[slot], player->name);
+        strncat(message, line, sizeof(message) - strlen(message) - 1);
+    }
+
+    for (int i = 0; i < table->numActive; i++){
+        emit(game, table->active[i], GAME_MSG_QUIT, message);
+    }
+    if (game->spectating){
+        emit(game, GAME_SPECTATOR, GAME_MSG_QUIT, message);
+    }
+}
+
+
+/**************** game_purse ****************/
+/* Return how much gold player has picked up.
+ * See game.h for more information. */
+int game_purse(game_t* game, int player)
+{
+    if (game == NULL || player < 0 || player >= game->table.count){
+        return 0;
+    }
+    return game->table.purse[player];
+}
+
+
+/**************** game_goldRemaining ****************/
+/* Return the number of nuggets not yet picked up.
+ * See game.h for more information. */
+int game_goldRemaining(game_t* game)
+{
+    return (game == NULL) ? 0 : gold_remaining(game->gold);
+}
+
+
+/**************** game_report ****************/
+/* Print how many DISPLAYs frames needed.
+ * See game.h for more information. */
+void game_report(game_t* game, FILE* fp)
+{
+    if (game == NULL || fp == NULL || game->frames == 0){
+        return;
+    }
+    long considered = game->displaysSent + game->displaysSkipped + game->displaysHeld;
+    fprintf(fp, "frames: %ld sent, %.2f DISPLAYs per frame (%ld sent, %ld skipped, %.1f%% of players unchanged)\n",
+            game->frames, (double)game->displaysSent / game->frames, game->displaysSent, game->displaysSkipped,
+            considered ? 100.0 * game->displaysSkipped / considered : 0.0);
+    if (game->displaysHeld > 0){
+        fprintf(fp, "frames: %ld DISPLAYs held back by pacing, superseded or sent later\n", game->displaysHeld);
+    }
+    fprintf(fp, "frames: %.0f bytes per DISPLAY\n",
+            game->displaysSent ? (double)game->displayBytes / game->displaysSent : 0.0);
+    fprintf(fp, "frames: %ld drawn whole, on %d worker thread(s) and the game's\n",
+            game->redraws, frame_poolWorkers(game->pool));
+}
+
+
+/**************** game_delete ****************/
+/* Free the game, including its map.
+ * See game.h for more information. */
+void game_delete(game_t* game)
+{
+    if (game == NULL){
+        return;
+    }
+
+    // each player's grids and name
+    for (int slot = 0; slot < game->table.count; slot++){
+        player_t* player = &game->table.players[slot];
+        freeMaps(player);
+        free(player->name);
+    }
+    free(game->table.occupants);
+    free(game->spectatorFrame);
+    free(game->view.overview);
+    free(game->view.region);
+    frame_deletePool(game->pool);
+    visibility_delete(game->vis);
+    moves_delete(game->moves);
+    gold_delete(game->gold);
+    rng_delete(game->rng);
+    grid_delete(game->map);
+    free(game);
+}
+
+
+/**************** emit ****************/
+/* Hand message, of the given type, for slot to the sink, if there is one. */
+static void emit(game_t* game, int slot, gameMessage_t type, const char* message)
+{
+    if (game->sink != NULL){
+        (*game->sink)(game->sinkArg, slot, type, message);
+    }
+}
+
+
+/**************** sendJoined ****************/
+/* Tell a player who just (re)joined their letter and the map size, work
+ * out what they see and who sees them, and mark a frame due. */
+static void sendJoined(game_t* game, int slot)
+{
+    playerTable_t* table = &game->table;
+    char joinMessage[] = "OK X";
+    joinMessage[3] = table->players[slot].playerChar;
+    emit(game, slot, GAME_MSG_OK, joinMessage);
+
+    if (game->sink != NULL){
+        char gridMessage[32];
+        snprintf(gridMessage, sizeof(gridMessage), "GRID %d %d", grid_getHeight(game->map), grid_getWidth(game->map));
+        emit(game, slot, GAME_MSG_GRID, gridMessage);
+    }
+
+    // let the new player see the others, and the others see them
+    updateVisibility(game, slot);
+    updateSeenRow(game, slot);
+    updateSeenColumn(game, slot, table->location[slot]);
+    visibility_speculate(game->vis, table->location[slot]);
+    game->frameDue = true;
+}
+
+
+/**************** applyKey ****************/
+/* Step or sprint slot by key; return true if anything changed.
+ * Calls in order: 1) find the new location, 2) updateGold,
+ * 3) updateVisibility, 4) swap with whoever was there, 5) changeAllVisibleMaps */
+static bool applyKey(game_t* game, int slot, char key)
+{
+    playerTable_t* table = &game->table;
+    int oldLoc = table->location[slot];
+
+    // y k u
+    // h @ l
+    // b j n
+    // capitals sprint, anything else is ignored
+    bool isSprint;
+    int direction = moves_direction(key, &isSprint);
+    if (direction < 0){
+        return false;
+    }
+    if (isSprint){
+        // the sprint table already knows where the walls and board edges are
+        sprint(game, slot, direction);
+        return true;
+    }
+
+    // -1 if we're just hitting a wall or going off the board
+    int newLoc = moves_step(game->moves, oldLoc, direction);
+    if (newLoc < 0){
+        return false;
+    }
+
+    table->location[slot] = newLoc;
+    updateGold(game, slot, newLoc);
+    updateVisibility(game, slot);
+
+    // swapping with player if I landed on them
+    int swapped = swapPlayerLocation(game, slot, oldLoc, newLoc);
+
+    changeAllVisibleMaps(game, slot, oldLoc, newLoc);
+    visibility_speculate(game->vis, newLoc);
+
+    // the swapped player moved too, so their view and who sees them changed
+    if (swapped >= 0){
+        updateVisibility(game, swapped);
+        updateSeenRow(game, swapped);
+        updateSeenColumn(game, swapped, newLoc);
+    }
+    return true;
+}
+
+
+/**************** sprint ****************/
+/* Run a whole sprint as one move, up to the end given by the sprint
+ * table: collect the gold and remember what is seen along the path, move
+ * the player, then updateVisibility and changeAllVisibleMaps once.
+ * Players only hear about it once it is done. */
+static void sprint(game_t* game, int slot, int direction)
+{
+    playerTable_t* table = &game->table;
+    int startLoc = table->location[slot];
+    int endLoc = moves_sprint(game->moves, startLoc, direction);
+    if (endLoc < 0){
+        endLoc = startLoc;
+    }
+
+    // walk the path: pick up its gold, and remember everything seen from it
+    int pickedUp = 0;
+    for (int loc = startLoc; loc != endLoc; ){
+        loc = moves_step(game->moves, loc, direction);
+
+        int amount = gold_pickUp(game->gold, loc);
+        if (amount > 0){
+            pickedUp += amount;
+            grid_set(game->map, loc, '.');
+            patchSpectator(game, loc);
+            clearGoldSightings(game, slot, loc);
+        }
+
+        // the end is seen by updateVisibility below
+        if (loc != endLoc){
+            rememberVisibility(game, slot, loc);
+        }
+    }
+
+    // then one move from the start to the end (sprinting runs over other players, no swaps)
+    if (endLoc != startLoc){
+        moveOccupant(game, slot, startLoc, endLoc);
+        table->location[slot] = endLoc;
+        updateVisibility(game, slot);
+        changeAllVisibleMaps(game, slot, startLoc, endLoc);
+    }
+    visibility_speculate(game->vis, endLoc);
+
+    // one GOLD goes out for everything picked up on the way
+    table->purse[slot] += pickedUp;
+    table->pickedUp[slot] += pickedUp;
+}
+
+
+/**************** updateGold ****************/
+/* Pick up any gold at loc into slot's purse and clear it from the map;
+ * the GOLD message goes out with the next frame. */
+static void updateGold(game_t* game, int slot, int loc)
+{
+    int justPickedUp = gold_pickUp(game->gold, loc);
+    if (justPickedUp > 0){
+        game->table.purse[slot] += justPickedUp;
+        game->table.pickedUp[slot] += justPickedUp;
+
+        // the pile is gone, so the map shows floor there again
+        grid_set(game->map, loc, '.');
+        patchSpectator(game, loc);
+    }
+}
+
+
+/**************** updateVisibility ****************/
+/* Rebuild slot's visibleMap from where they stand, and add it to their
+ * placesSeen. */
+static void updateVisibility(game_t* game, int slot)
+{
+    player_t* player = &game->table.players[slot];
+
+    // every cell seen from the new location (cached if precomputing)
+    const int* cells;
+    int count = visibility_get(game->vis, game->table.location[slot], &cells);
+
+    // patch the frame cell by cell, unless so many change that one pass
+    // over the whole of it is cheaper
+    bool redraw = (player->numLit + count) * REDRAW_RATIO > grid_getLength(game->map);
+
+    // blank only what was lit before, not the whole map
+    for (int i = 0; i < player->numLit; i++){
+        grid_set(player->visibleMap, player->lit[i], ' ');
+        if (!redraw){
+            patchCell(game, slot, player->lit[i]);
+        }
+    }
+
+    player->numGold = 0;
+    for (int i = 0; i < count; i++){
+        // visible map gets gold too, places seen only remembers the floor
+        char spot = grid_get(game->map, cells[i]);
+        grid_set(player->visibleMap, cells[i], spot);
+        grid_set(player->placesSeen, cells[i], spot == '*' ? '.' : spot);
+        if (spot == '*' && player->numGold < GOLD_MAX_NUM_PILES){
+            player->gold[player->numGold++] = cells[i];
+        }
+        player->lit[i] = cells[i];
+        if (!redraw){
+            patchCell(game, slot, cells[i]);
+        }
+    }
+    player->numLit = count;
+
+    if (redraw){
+        redrawFrame(game, slot);
+    }
+}
+
+
+/**************** rememberVisibility ****************/
+/* Add everything seen from loc to slot's placesSeen, leaving their
+ * visibleMap alone: it is rebuilt where the player stops. */
+static void rememberVisibility(game_t* game, int slot, int loc)
+{
+    grid_t* placesSeen = game->table.players[slot].placesSeen;
+    const int* cells;
+    int count = visibility_get(game->vis, loc, &cells);
+
+    for (int i = 0; i < count; i++){
+        // places seen only remembers the floor
+        char spot = grid_get(game->map, cells[i]);
+        grid_set(placesSeen, cells[i], spot == '*' ? '.' : spot);
+        patchCell(game, slot, cells[i]);
+    }
+}
+
+
+/**************** clearGoldSightings ****************/
+/* Show floor instead of gold at loc on the visibleMap of everyone but
+ * the picker: anyone who saw the pile would have seen the picker pass
+ * over it, and floor after. */
+static void clearGoldSightings(game_t* game, int pickerSlot, int loc)
+{
+    playerTable_t* table = &game->table;
+    for (int i = 0; i < table->numActive; i++){
+        int slot = table->active[i];
+        player_t* player = &table->players[slot];
+        if (slot != pickerSlot && grid_get(player->visibleMap, loc) == '*'){
+            grid_set(player->visibleMap, loc, '.');
+            patchCell(game, slot, loc);
+
+            // and off their list of gold in view, last one into its place
+            for (int g = 0; g < player->numGold; g++){
+                if (player->gold[g] == loc){
+                    player->gold[g] = player->gold[--player->numGold];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+/**************** changeAllVisibleMaps ****************/
+/* Draw slot at newLoc on their own (rebuilt) visibleMap, then fix the
+ * seen matrix: updateSeenRow, then updateSeenColumn. */
+static void changeAllVisibleMaps(game_t* game, int slot, int oldLoc, int newLoc)
+{
+    player_t* player = &game->table.players[slot];
+
+    // the old spot is only put back if it is still in view (a sprint can leave it far behind)
+    if (grid_get(player->visibleMap, oldLoc) != ' '){
+        grid_set(player->visibleMap, oldLoc, grid_get(game->map, oldLoc));
+        patchCell(game, slot, oldLoc);
+    }
+    grid_set(player->visibleMap, newLoc, player->playerChar);
+    player->lit[player->numLit++] = newLoc;
+    patchCell(game, slot, newLoc);
+
+    // the moved player's visibleMap was rebuilt, so redo their row
+    updateSeenRow(game, slot);
+
+    // only players who saw the moved player before or see them now change
+    updateSeenColumn(game, slot, oldLoc);
+}
+
+
+/**************** updateSeenRow ****************/
+/* Recompute which players mySlot sees from their (fresh) visibleMap, and
+ * stamp those players onto it. */
+static void updateSeenRow(game_t* game, int mySlot)
+{
+    playerTable_t* table = &game->table;
+    grid_t* visibleMap = table->players[mySlot].visibleMap;
+    uint32_t row = 0;
+
+    for (int i = 0; i < table->numActive; i++){
+        int slot = table->active[i];
+        if (slot == mySlot){
+            continue;
+        }
+
+        // visible iff that spot is not blank in my visibleMap, then show them there
+        int loc = table->location[slot];
+        if (grid_get(visibleMap, loc) != ' '){
+            row |= (uint32_t)1 << slot;
+            grid_set(visibleMap, loc, table->players[slot].playerChar);
+            patchCell(game, mySlot, loc);
+        }
+    }
+    table->canSee[mySlot] = row;
+}
+
+
+/**************** updateSeenColumn ****************/
+/* Move movedSlot's letter from oldLoc to where they are now for every
+ * other player, touching only the views where they were or are seen. */
+static void updateSeenColumn(game_t* game, int movedSlot, int oldLoc)
+{
+    playerTable_t* table = &game->table;
+    uint32_t bit = (uint32_t)1 << movedSlot;
+    int newLoc = table->location[movedSlot];
+    char movedChar = table->players[movedSlot].playerChar;
+
+    for (int i = 0; i < table->numActive; i++){
+        int slot = table->active[i];
+        if (slot == movedSlot){
+            continue;
+        }
+        grid_t* otherVisibleMap = table->players[slot].visibleMap;
+        bool wasSeen = (table->canSee[slot] & bit) != 0;
+        bool nowSeen = grid_get(otherVisibleMap, newLoc) != ' ';
+
+        // nothing to do if they never saw the moved player
+        if (!wasSeen && !nowSeen){
+            continue;
+        }
+
+        // erase the old sighting, unless someone else has been drawn there since
+        if (wasSeen && grid_get(otherVisibleMap, oldLoc) == movedChar){
+            grid_set(otherVisibleMap, oldLoc, grid_get(game->map, oldLoc));
+            patchCell(game, slot, oldLoc);
+        }
+        if (nowSeen){
+            grid_set(otherVisibleMap, newLoc, movedChar);
+            patchCell(game, slot, newLoc);
+            table->canSee[slot] |= bit;
+        }
+        else{
+            table->canSee[slot] &= ~bit;
+        }
+    }
+}
+
+
+/**************** swapPlayerLocation ****************/
+/* Move slot from oldLoc to newLoc, and whoever was at newLoc (one load)
+ * to oldLoc; return the slot swapped, or -1. */
+static int swapPlayerLocation(game_t* game, int slot, int oldLoc, int newLoc)
+{
+    playerTable_t* table = &game->table;
+    int other = playerAt(table, newLoc, slot);
+    moveOccupant(game, slot, oldLoc, newLoc);
+    if (other >= 0){
+        moveOccupant(game, other, newLoc, oldLoc);
+        table->location[other] = oldLoc;
+    }
+    return other;
+}
+
+
+/**************** moveOccupant ****************/
+/* Move slot's bit in the occupancy grid from oldLoc to newLoc (oldLoc -1
+ * places them, newLoc -1 takes them off the map), and redraw both cells
+ * for the spectator. */
+static void moveOccupant(game_t* game, int slot, int oldLoc, int newLoc)
+{
+    playerTable_t* table = &game->table;
+    uint32_t bit = (uint32_t)1 << slot;
+    if (oldLoc >= 0){
+        table->occupants[oldLoc] &= ~bit;
+        patchSpectator(game, oldLoc);
+    }
+    if (newLoc >= 0){
+        table->occupants[newLoc] |= bit;
+        patchSpectator(game, newLoc);
+    }
+}
+
+
+/**************** playerAt ****************/
+/* Return the slot of the player at loc other than exceptSlot (the lowest
+ * slot if several), or -1. */
+static int playerAt(playerTable_t* table, int loc, int exceptSlot)
+{
+    uint32_t mask = table->occupants[loc];
+    if (exceptSlot >= 0){
+        mask &= ~((uint32_t)1 << exceptSlot);
+    }
+    return (mask == 0) ? -1 : __builtin_ctz(mask);
+}
+
+
+/**************** randomFloor ****************/
+/* Return a random cell of empty floor with nobody on it, guessing
+ * locations until one is. */
+static int randomFloor(game_t* game)
+{
+    int length = grid_getLength(game->map);
+    int loc = 0;
+    while (grid_get(game->map, loc) != '.' || game->table.occupants[loc] != 0){
+        loc = rng_below(game->rng, length);
+    }
+    return loc;
+}
+
+
+/**************** activatePlayer ****************/
+/* Put slot in the active list, keeping it in slot order. */
+static void activatePlayer(playerTable_t* table, int slot)
+{
+    // shift the later slots up one, insertion sort style
+    int i = table->numActive;
+    while (i > 0 && table->active[i - 1] > slot){
+        table->active[i] = table->active[i - 1];
+        i--;
+    }
+    table->active[i] = slot;
+    table->numActive++;
+}
+
+
+/**************** retirePlayer ****************/
+/* Take a player who quit out of the game: off the active list and the
+ * map, out of everyone's view, and free their maps (their name and purse
+ * stay, for the scoreboard). */
+static void retirePlayer(game_t* game, int slot)
+{
+    playerTable_t* table = &game->table;
+
+    // off the active list, closing the gap
+    int i = 0;
+    while (i < table->numActive && table->active[i] != slot){
+        i++;
+    }
+    if (i == table->numActive){
+        return;
+    }
+    for (; i + 1 < table->numActive; i++){
+        table->active[i] = table->active[i + 1];
+    }
+    table->numActive--;
+    table->isActive[slot] = false;
+    game->numKeys[slot] = 0;
+
+    // off the map, and out of the view of everyone who could see them
+    int loc = table->location[slot];
+    uint32_t bit = (uint32_t)1 << slot;
+    moveOccupant(game, slot, loc, -1);
+    int under = playerAt(table, loc, -1);
+    for (i = 0; i < table->numActive; i++){
+        int other = table->active[i];
+        if ((table->canSee[other] & bit) == 0){
+            continue;
+        }
+        grid_t* otherVisibleMap = table->players[other].visibleMap;
+        if (grid_get(otherVisibleMap, loc) == table->players[slot].playerChar){
+            grid_set(otherVisibleMap, loc, under >= 0 ? table->players[under].playerChar : grid_get(game->map, loc));
+            patchCell(game, other, loc);
+        }
+        table->canSee[other] &= ~bit;
+    }
+    table->canSee[slot] = 0;
+    game->dirty &= ~bit;
+    game->held &= ~bit;
+    game->redraw &= ~bit;
+
+    // everyone who saw them, and the spectators, are sent the board without them
+    game->frameDue = true;
+
+    freeMaps(&table->players[slot]);
+}
+
+
+/**************** newMaps ****************/
+/* Give player empty grids for their visible map and places seen, and a
+ * blank frame; return false (with none of them) if they cannot be made. */
+static bool newMaps(game_t* game, player_t* player)
+{
+    int mapLen = grid_getLength(game->map);
+    player->visibleMap = grid_new(grid_getMap(game->map));
+    player->placesSeen = grid_new(grid_getMap(game->map));
+    player->frame = malloc(DISPLAY_PREFIX_LEN + mapLen + 1);
+    // everything seen from one cell, and the player's own cell
+    player->lit = malloc((visibility_maxCells(game->vis) + 1) * sizeof(int));
+    // every pile, every player, and the '@'
+    player->gold = malloc(GOLD_MAX_NUM_PILES * sizeof(int));
+    player->sprites = malloc((GOLD_MAX_NUM_PILES + GAME_MAX_PLAYERS + 1) * sizeof(sprite_t));
+    if (player->visibleMap == NULL || player->placesSeen == NULL ||
+        player->frame == NULL || player->lit == NULL || player->gold == NULL || player->sprites == NULL){
+        freeMaps(player);
+        return false;
+    }
+    grid_makeEmpty(player->visibleMap);
+    grid_makeEmpty(player->placesSeen);
+    memcpy(player->frame, DISPLAY_PREFIX, DISPLAY_PREFIX_LEN);
+    memcpy(player->frame + DISPLAY_PREFIX_LEN, grid_getMap(player->placesSeen), mapLen + 1);
+    player->numLit = 0;
+    player->numGold = 0;
+    player->drawnAt = -1;
+    return true;
+}
+
+
+/**************** freeMaps ****************/
+/* Free player's grids and frames, leaving NULLs (and no viewport). */
+static void freeMaps(player_t* player)
+{
+    grid_delete(player->visibleMap);
+    grid_delete(player->placesSeen);
+    free(player->frame);
+    free(player->lit);
+    free(player->gold);
+    free(player->sprites);
+    free(player->window);
+    player->visibleMap = NULL;
+    player->placesSeen = NULL;
+    player->frame = NULL;
+    player->lit = NULL;
+    player->gold = NULL;
+    player->sprites = NULL;
+    player->window = NULL;
+    player->viewRows = 0;
+    player->viewCols = 0;
+}
+
+
+/**************** patchCell ****************/
+/* Redraw loc in slot's frame: '@' for themselves, gold or a player if
+ * they see one there now, otherwise what they remember. Must follow every
+ * change to a cell of the player's maps. */
+static void patchCell(game_t* game, int slot, int loc)
+{
+    if (game->sink == NULL){
+        return;     // frames are never sent
+    }
+    if (game->redraw & ((uint32_t)1 << slot)){
+        return;     // the whole frame is drawn before it is sent
+    }
+    player_t* player = &game->table.players[slot];
+    char c = grid_get(player->visibleMap, loc);
+    if (loc == player->drawnAt){
+        c = '@';
+    }
+    else if (c != '*' && !(c >= 'A' && c <= 'Z')){
+        c = grid_get(player->placesSeen, loc);
+    }
+    char* cell = &player->frame[DISPLAY_PREFIX_LEN + loc];
+    if (*cell != c){
+        *cell = c;
+        game->dirty |= (uint32_t)1 << slot;
+    }
+}
+
+
+/**************** redrawFrame ****************/
+/* Have the whole of slot's frame drawn again from their maps, like
+ * patchCell on every cell, before it is next sent; patchCell leaves it
+ * alone until then. */
+static void redrawFrame(game_t* game, int slot)
+{
+    if (game->sink == NULL){
+        return;
+    }
+    // only ever needed when a lot changed, so no need to check
+    game->redraw |= (uint32_t)1 << slot;
+    game->dirty |= (uint32_t)1 << slot;
+}
+
+
+/**************** composeFrames ****************/
+/* Draw every frame waiting to be drawn whole, but those of held players
+ * (they may change again before they are sent), all at once on the
+ * game's threads: each is placesSeen with its sprites on. */
+static void composeFrames(game_t* game)
+{
+    frameJob_t jobs[GAME_MAX_PLAYERS];
+    int count = 0;
+    uint32_t drawn = game->redraw & ~game->held;
+    for (int slot = 0; slot < GAME_MAX_PLAYERS; slot++){
+        if (drawn & ((uint32_t)1 << slot)){
+            player_t* player = &game->table.players[slot];
+            jobs[count].out = player->frame + DISPLAY_PREFIX_LEN;
+            jobs[count].background = grid_getMap(player->placesSeen);
+            jobs[count].length = grid_getLength(game->map);
+            jobs[count].sprites = player->sprites;
+            jobs[count].count = listSprites(game, slot);
+            count++;
+        }
+    }
+    frame_drawAll(game->pool, jobs, count);
+    game->redraw &= ~drawn;
+    game->redraws += count;
+}
+
+
+/**************** listSprites ****************/
+/* Fill slot's sprites with what their visibleMap shows on top of
+ * placesSeen: the gold in view, then every player (who is a letter on it
+ * if in view, and only then), then the '@'; return how many. Only gold
+ * and players can be drawn over placesSeen, so this is the whole of it. */
+static int listSprites(game_t* game, int slot)
+{
+    playerTable_t* table = &game->table;
+    player_t* player = &table->players[slot];
+    int count = 0;
+    for (int i = 0; i < player->numGold + table->numActive; i++){
+        int loc = (i < player->numGold) ? player->gold[i] : table->location[table->active[i - player->numGold]];
+        char c = grid_get(player->visibleMap, loc);
+        if (c == '*' || (c >= 'A' && c <= 'Z')){
+            player->sprites[count].loc = loc;
+            player->sprites[count].c = c;
+            count++;
+        }
+    }
+    if (player->drawnAt >= 0){
+        player->sprites[count].loc = player->drawnAt;
+        player->sprites[count].c = '@';
+        count++;
+    }
+    return count;
+}
+
+
+/**************** patchSpectator ****************/
+/* Redraw loc in the spectator's frame: the player standing there (the
+ * lowest slot if several), otherwise the map. Must follow every change
+ * to the occupancy grid or the map. */
+static void patchSpectator(game_t* game, int loc)
+{
+    if (game->sink == NULL){
+        return;     // frames are never sent
+    }
+    int slot = playerAt(&game->table, loc, -1);
+    char c = (slot >= 0) ? game->table.players[slot].playerChar : grid_get(game->map, loc);
+    char* cell = &game->spectatorFrame[DISPLAY_PREFIX_LEN + loc];
+    if (*cell != c){
+        *cell = c;
+        game->spectatorDirty = true;
+        if (game->view.scale > 1){
+            patchOverview(game, loc);
+        }
+    }
+}
+
+
+/**************** patchOverview ****************/
+/* Redraw the overview cell of the block holding loc: the most telling
+ * char of the block in the spectator's frame (see detail), the first
+ * one found if there is a tie. */
+static void patchOverview(game_t* game, int loc)
+{
+    spectatorView_t* view = &game->view;
+    int stride = grid_getWidth(game->map) + 1;
+    int height = grid_getHeight(game->map);
+    int blockRow = loc / stride / view->scale;
+    int blockCol = loc % stride / view->scale;
+    int top = blockRow * view->scale;
+    int left = blockCol * view->scale;
+    int bottom = (top + view->scale < height) ? top + view->scale : height;
+    int right = (left + view->scale < stride - 1) ? left + view->scale : stride - 1;
+
+    const char* map = game->spectatorFrame + DISPLAY_PREFIX_LEN;
+    char best = ' ';
+    for (int r = top; r < bottom; r++){
+        for (int c = left; c < right; c++){
+            if (detail(map[r * stride + c]) > detail(best)){
+                best = map[r * stride + c];
+            }
+        }
+    }
+    view->overview[view->headerLen + blockRow * (view->cols + 1) + blockCol] = best;
+}
+
+
+/**************** detail ****************/
+/* Rank what a cell shows, for the overview: players, then gold, then
+ * floor, passages, walls, and nothing. */
+static int detail(char c)
+{
+    if (c >= 'A' && c <= 'Z'){
+        return 5;
+    }
+    switch (c){
+        case '*': return 4;
+        case '.': return 3;
+        case '#': return 2;
+        case ' ': return 0;
+        default:  return 1;
+    }
+}
+
+
+/**************** sendGold ****************/
+/* If any gold was picked up since the last GOLD, tell every player
+ * GOLD n p r: what they picked up since (maybe 0), their purse, and the
+ * nuggets left. */
+static void sendGold(game_t* game)
+{
+    playerTable_t* table = &game->table;
+
+    // nothing to say if no gold was picked up
+    bool anyPickedUp = false;
+    for (int i = 0; i < table->numActive; i++){
+        anyPickedUp = anyPickedUp || table->pickedUp[table->active[i]] > 0;
+    }
+    if (!anyPickedUp){
+        return;
+    }
+
+    // total gold left is kept up to date by the gold store
+    int nuggetsRemaining = gold_remaining(game->gold);
+    for (int i = 0; i < table->numActive; i++){
+        int slot = table->active[i];
+        if (game->sink != NULL){
+            char message[50];
+            snprintf(message, sizeof(message), "GOLD %d %d %d", table->pickedUp[slot], table->purse[slot], nuggetsRemaining);
+            emit(game, slot, GAME_MSG_GOLD, message);
+        }
+        table->pickedUp[slot] = 0;
+    }
+}
+
+
+/**************** sendDisplay ****************/
+/* Send slot their map: everywhere they have been, with the gold and
+ * players they see now on top, and '@' for themselves. The frame is kept
+ * up to date by patchCell, so only the '@' may need moving; if none of
+ * it changed since they were last sent it, nothing is sent. */
+static void sendDisplay(game_t* game, int slot)
+{
+    player_t* player = &game->table.players[slot];
+    if (player->frame == NULL){
+        return;
+    }
+    int loc = game->table.location[slot];
+    if (player->drawnAt != loc){
+        int oldLoc = player->drawnAt;
+        player->drawnAt = loc;
+        if (oldLoc >= 0){
+            patchCell(game, slot, oldLoc);
+        }
+        patchCell(game, slot, loc);
+    }
+    uint32_t bit = (uint32_t)1 << slot;
+    if ((game->dirty & bit) == 0){
+        game->displaysSkipped++;
+        return;
+    }
+    if (game->held & bit){
+        game->displaysHeld++;       // stays dirty, and keeps changing
+        return;
+    }
+    game->dirty &= ~bit;
+    const char* message = (player->viewRows > 0) ? cutWindow(game, slot) : player->frame;
+    game->displaysSent++;
+    game->displayBytes += strlen(message);
+    emit(game, slot, GAME_MSG_FRAME, message);
+}
+
+
+/**************** cutWindow ****************/
+/* Copy the viewport around slot out of their frame, centred on them as
+ * far as the edges of the map allow, under a "DISPLAY top left" header;
+ * return it. */
+static const char* cutWindow(game_t* game, int slot)
+{
+    player_t* player = &game->table.players[slot];
+    int stride = grid_getWidth(game->map) + 1;      // each row ends in '\n'
+    int rows = player->viewRows;
+    int cols = player->viewCols;
+    int loc = game->table.location[slot];
+
+    int top = loc / stride - rows / 2;
+    int left = loc % stride - cols / 2;
+    int maxTop = grid_getHeight(game->map) - rows;
+    int maxLeft = stride - 1 - cols;
+    top = top < 0 ? 0 : (top > maxTop ? maxTop : top);
+    left = left < 0 ? 0 : (left > maxLeft ? maxLeft : left);
+
+    cutRegion(player->window, player->frame + DISPLAY_PREFIX_LEN, stride, top, left, rows, cols);
+    return player->window;
+}
+
+
+/**************** cutRegion ****************/
+/* Write "DISPLAY top left", a newline, and rows lines of cols chars of map
+ * (rows stride chars apart) from row top and column left, to out. */
+static void cutRegion(char* out, const char* map, int stride, int top, int left, int rows, int cols)
+{
+    out += snprintf(out, GAME_WINDOW_HEADER_MAX, "DISPLAY %d %d\n", top, left);
+    for (int r = 0; r < rows; r++){
+        memcpy(out, map + (top + r) * stride + left, cols);
+        out[cols] = '\n';
+        out += cols + 1;
+    }
+    *out = '\0';
+}
+
+
+/**************** sendSpectatorDisplay ****************/
+/* Send the spectators the whole map, with every active player on it, if
+ * it changed, and return whether it was sent. The frame is kept up to
+ * date by patchSpectator, so there is nothing to draw. */
+static bool sendSpectatorDisplay(game_t* game)
+{
+    if (game->spectatorDirty && !game->spectatorHeld){
+        game->spectatorDirty = false;
+        sendSpectatorView(game, GAME_SPECTATOR);
+        return true;
+    }
+    return false;
+}
+
+
+/**************** sendSpectatorView ****************/
+/* Send target (GAME_SPECTATOR or GAME_NEW_SPECTATOR) the overview and the
+ * region, whichever are on, or else the whole map. */
+static void sendSpectatorView(game_t* game, int target)
+{
+    spectatorView_t* view = &game->view;
+    if (view->scale > 1){
+        emit(game, target, GAME_MSG_FRAME, view->overview);
+    }
+    if (view->regionRows > 0){
+        cutRegion(view->region, game->spectatorFrame + DISPLAY_PREFIX_LEN, grid_getWidth(game->map) + 1,
+                  view->top, view->left, view->regionRows, view->regionCols);
+        emit(game, target, GAME_MSG_FRAME, view->region);
+    }
+    if (view->scale == 1 && view->regionRows == 0){
+        emit(game, target, GAME_MSG_FRAME, game->spectatorFrame);
+    }
+}
@@ -0,0 +1,274 @@
+/*
+ * game.h - header file for game module
+ *
+ * One game of Nuggets, with no networking: players join, keys move
+ * them, gold is picked up, and every client's view is kept up to date.
+ * Whatever a client should be told (OK, GRID, GOLD, DISPLAY, QUIT) is
+ * handed to a sink function as a protocol message, along with its type
+ * and the player it is for; the server's sink sends it over UDP, a
+ * simulation can count it, drop it or do nothing at all.
+ *
+ * Players are numbered by slot, 0 to GAME_MAX_PLAYERS - 1, and slot i is
+ * the letter 'A' + i. Messages for the spectators go to GAME_SPECTATOR:
+ * the game draws one spectator view, however many are watching, and the
+ * sink hands each message to all of them.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#ifndef __GAME_H
+#define __GAME_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "grid.h"
+#include "visibility.h"
+
+
+/**************** global types ****************/
+typedef struct game game_t;
+
+#define GAME_MAX_PLAYERS 26     // one per letter
+#define GAME_SPECTATOR -1       // the player messages to every spectator are for
+#define GAME_NEW_SPECTATOR -2   // ... and to the spectator who just started watching
+#define GAME_WINDOW_HEADER_MAX 32   // bytes before a window's rows: "DISPLAY top left\n" or "OVERVIEW scale\n"
+
+// what kind of protocol message a sink is handed
+typedef enum gameMessage {
+    GAME_MSG_OK,        // "OK L"
+    GAME_MSG_GRID,      // "GRID rows cols"
+    GAME_MSG_GOLD,      // "GOLD n p r"
+    GAME_MSG_FRAME,     // "DISPLAY ..." or "OVERVIEW ...": what a client sees
+    GAME_MSG_QUIT       // "QUIT ..."
+} gameMessage_t;
+
+// where a game's messages go; message is only valid during the call
+typedef void (*game_sink_t)(void* arg, int player, gameMessage_t type, const char* message);
+
+
+/**************** functions ****************/
+
+/**************** game_new ****************/
+/* Start a game on map, seeding its random numbers with seed, where
+ * players see radius cells far.
+ *
+ * Notes:
+ *   the game takes map over, and frees it in game_delete
+ *   gold is placed (and, later, players spawned) from the seed alone, so
+ *     the same seed and the same calls give the same messages
+ *   sink may be NULL, in which case no messages are built at all, which
+ *     makes a game that is only stepped as fast as it can be
+ *   no threads are started: whole frames are drawn on the thread that
+ *     flushes, unless game_frameThreads gives the game a pool
+ *   returns NULL on any error
+ *   caller is responsible for calling game_delete
+ *
+ * create the random number generator
+ * place the gold, build the movement tables and the visibility object
+ * create the empty player table and occupancy grid
+ */
+game_t* game_new(grid_t* map, uint64_t seed, int radius, game_sink_t sink, void* sinkArg);
+
+
+/**************** game_visibility ****************/
+/* Return the game's visibility object, so the caller can choose how it
+ * is computed (see visibility_setStrategy and vistune_choose).
+ */
+visibility_t* game_visibility(game_t* game);
+
+
+/**************** game_frameThreads ****************/
+/* Draw whole frames on a pool of worker threads from now on, as many as
+ * workers (see frame_newPool: < 0 is one per spare CPU, 0 is none, the
+ * thread that flushes).
+ * Return false, leaving frames drawn on the flushing thread, if the
+ * pool cannot be made.
+ */
+bool game_frameThreads(game_t* game, int workers);
+
+
+/**************** game_join ****************/
+/* Add a new player called name, at a random empty spot of floor, and
+ * return their slot, or -1 if all the slots are taken.
+ *
+ * Notes:
+ *   slots are handed out in order: the new player's is game_numPlayers
+ *     from just before the call, so the caller can be ready to deliver
+ *     their messages
+ *   the player is sent OK and GRID at once; their first DISPLAY (and
+ *     everyone's, now that they can see the newcomer) goes out with the
+ *     next game_flush or game_tick
+ */
+int game_join(game_t* game, const char* name);
+
+
+/**************** game_rejoin ****************/
+/* Bring back the player in slot, who quit, under name. They get the
+ * same letter, an empty purse and the spot they left, or if somebody is
+ * standing there now, a random empty floor cell as in game_join. Return
+ * slot, or -1 if slot is not a player who quit. Sends like game_join.
+ */
+int game_rejoin(game_t* game, int player, const char* name);
+
+
+/**************** game_numPlayers ****************/
+/* Return the number of players who have ever joined. */
+int game_numPlayers(game_t* game);
+
+
+/**************** game_isActive ****************/
+/* Return true if player has joined and not quit. */
+bool game_isActive(game_t* game, int player);
+
+
+/**************** game_spectate ****************/
+/* Start (watching true) or stop sending spectators a full view.
+ *
+ * Notes:
+ *   call it with true for every spectator who starts watching: they are
+ *     sent GRID and the current DISPLAY at once, to GAME_NEW_SPECTATOR, so
+ *     those already watching are not sent them again
+ *   call it with false when the last spectator leaves
+ */
+void game_spectate(game_t* game, bool watching);
+
+
+/**************** game_spectatorOverview ****************/
+/* Send spectators an overview of the map, one cell per scale by scale
+ * block of it, instead of the whole map; scale 1 goes back to the whole
+ * map. Return false if scale is less than 1 or there is no memory.
+ *
+ * Notes:
+ *   it is sent as "OVERVIEW scale" and a newline, then one line per scale
+ *     rows of the map, each one char per scale columns
+ *   each block shows what matters most in it: a player, then gold, then
+ *     floor, passage, wall, and blank
+ *   for maps whose DISPLAY would not fit in one datagram; the spectators
+ *     all share the one view
+ */
+bool game_spectatorOverview(game_t* game, int scale);
+
+
+/**************** game_spectatorRegion ****************/
+/* Also send spectators rows by cols of the map at full detail, from row
+ * top and column left (cut off at the edges of the map), as a viewport
+ * is sent: "DISPLAY top left", a newline, and the rows. rows or cols 0
+ * stops it. Return false if the corner is off the map or a size is
+ * negative.
+ *
+ * Notes:
+ *   with no overview on, the region is sent instead of the whole map
+ */
+bool game_spectatorRegion(game_t* game, int top, int left, int rows, int cols);
+
+
+/**************** game_viewport ****************/
+/* Send player only a rows by cols window of their map, around them,
+ * from the next frame on, or (rows or cols 0) the whole map again.
+ *
+ * Notes:
+ *   a window is sent as "DISPLAY top left" and a newline, then rows lines
+ *     of cols chars: the map rows top to top + rows - 1, columns left to
+ *     left + cols - 1. It is centred on the player as far as the edges of
+ *     the map allow, and never bigger than the map
+ *   the player is sent a frame in the new form with the next game_flush
+ *   the viewport ends when the player quits
+ *   returns false if player is not active, a size is negative, or there
+ *     is no memory for the window
+ */
+bool game_viewport(game_t* game, int player, int rows, int cols);
+
+
+/**************** game_hold ****************/
+/* Stop (hold true) or go back to sending player (or GAME_SPECTATOR, for
+ * the spectators) their frames.
+ *
+ * Notes:
+ *   a held player's frame goes on changing; the first game_flush after
+ *     they are let go sends them it as it is then, once, however many
+ *     frames it stood in for
+ *   game_flush stays due while a held player has a frame waiting, so it
+ *     can be called again just to let frames go
+ *   GOLD and QUIT messages are never held
+ */
+void game_hold(game_t* game, int player, bool hold);
+
+
+/**************** game_step ****************/
+/* Apply one key from player right away.
+ *
+ * Notes:
+ *   hjklyubn step, HJKLYUBN sprint, Q or q quits (the player is sent
+ *     QUIT at once); other keys, and keys from players who are not
+ *     active, are ignored
+ *   nothing is sent for a move until game_flush, so several steps can
+ *     share a frame
+ *   returns true if the game is over (all the gold is taken)
+ */
+bool game_step(game_t* game, int player, char key);
+
+
+/**************** game_queue ****************/
+/* Queue a key from player for the next game_tick. Return false (and
+ * drop it) if player already has as many keys queued as a tick takes.
+ * Q still quits at once, as in game_step.
+ */
+bool game_queue(game_t* game, int player, char key);
+
+
+/**************** game_tick ****************/
+/* Apply the queued keys round robin (every player's first key, in slot
+ * order, then every second key, ...), then game_flush. Return true if
+ * the game is over.
+ */
+bool game_tick(game_t* game);
+
+
+/**************** game_flush ****************/
+/* If anything changed since the last frame, send it: a GOLD to every
+ * player if any gold was picked up, then a DISPLAY to every player whose
+ * view changed, and to the spectators (one message for all of them) if
+ * theirs did.
+ */
+void game_flush(game_t* game);
+
+
+/**************** game_over ****************/
+/* Return true if all the gold has been picked up. */
+bool game_over(game_t* game);
+
+
+/**************** game_end ****************/
+/* Send the final scores (QUIT GAME OVER, one line per player who ever
+ * joined) to every active player and the spectators.
+ */
+void game_end(game_t* game);
+
+
+/**************** game_purse ****************/
+/* Return how much gold player has picked up, or 0 if there is no such
+ * player.
+ */
+int game_purse(game_t* game, int player);
+
+
+/**************** game_goldRemaining ****************/
+/* Return the number of nuggets not yet picked up. */
+int game_goldRemaining(game_t* game);
+
+
+/**************** game_report ****************/
+/* Print to fp how many frames were sent and how many players, on
+ * average, each went to: a player whose view did not change is not sent
+ * a DISPLAY. Prints nothing if no frame was sent.
+ */
+void game_report(game_t* game, FILE* fp);
+
+
+/**************** game_delete ****************/
+/* Free the game, including its map. */
+void game_delete(game_t* game);
+
+#endif // __GAME_H
@@ -0,0 +1,974 @@
+/* Nate Abbott
+ * CS50 Nuggets
+ *
+ * gametest.c - test file for the game module
+ *
+ * Plays whole games with no networking, through game_step and a sink
+ * that only counts and hashes what would have been sent: checks that all
+ * the gold ends up in purses, that the same seed replays the same
+ * messages, that quitting, rejoining and a full game behave, that only
+ * players whose view changed are sent a DISPLAY, that a viewport (and a
+ * spectator's region and overview) agree with the whole frame, and that
+ * frame_draw draws what the cell-by-cell rule would. Prints how many
+ * moves a second a game runs with no sink at all. Run from the top of the
+ * repo, like gridtest.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "grid.h"
+#include "game.h"
+#include "visibility.h"
+#include "rng.h"
+#include "frame.h"
+
+static const char* KEYS = "hjklyubnhjklyubnHJKLYUBN";   // mostly steps, some sprints
+static const int MAX_MOVES = 1000000;
+static const char* ROOM =               // one open room, everyone in it
+    "+------------------+\n"
+    "|..................|\n"
+    "|..................|\n"
+    "|..................|\n"
+    "|..................|\n"
+    "|..................|\n"
+    "|..................|\n"
+    "+------------------+\n";
+
+// what a counting sink has seen
+typedef struct tally {
+    int messages;
+    int quits;              // QUIT messages
+    uint64_t hash;          // FNV-1a of every (player, message)
+    char last[32];          // start of the last message
+    int mistyped;           // messages whose type does not match their first word
+} tally_t;
+
+// the GOLD messages of one frame, by player
+typedef struct goldFrame {
+    int golds[GAME_MAX_PLAYERS];        // GOLD messages to each player
+    int pickedUp[GAME_MAX_PLAYERS];     // n, p and r of the last one
+    int purse[GAME_MAX_PLAYERS];
+    int remaining;
+} goldFrame_t;
+
+// the DISPLAY each player, and the spectators, got last
+typedef struct lastFrames {
+    char* last[GAME_MAX_PLAYERS];
+    int got[GAME_MAX_PLAYERS];      // DISPLAYs to each player
+    int displays;
+    int repeats;            // DISPLAYs the same as the one before
+    char* spectator;
+    int spectatorGot;
+} lastFrames_t;
+
+// the last of each kind of message the spectators got
+typedef struct spectatorFeed {
+    char* overview;
+    char* display;          // whole map or region
+    int frames;
+} spectatorFeed_t;
+
+game_t* load(const char* mapFile, uint64_t seed, game_sink_t sink, void* arg);
+void countMessage(void* arg, int player, gameMessage_t type, const char* message);
+void collectGold(void* arg, int player, gameMessage_t type, const char* message);
+void keepFrames(void* arg, int player, gameMessage_t type, const char* message);
+void keepSpectator(void* arg, int player, gameMessage_t type, const char* message);
+int play(game_t* game, int players, uint64_t seed);
+bool test_fullGame(const char* mapFile);
+bool test_replay(const char* mapFile);
+bool test_quitAndRejoin(void);
+bool test_quitterGone(bool ticked);
+bool test_rejoinTaken(void);
+int whereAmI(lastFrames_t* frames, int player);
+bool test_gameFull(void);
+bool test_goldBatching(const char* mapFile);
+bool test_changedFramesOnly(const char* mapFile);
+bool test_viewport(const char* mapFile);
+bool test_overview(const char* mapFile);
+bool test_hold(const char* mapFile);
+bool sameWindow(const char* window, const char* frame, int rows, int cols, bool mine);
+bool sameOverview(const char* overview, const char* frame, int scale);
+bool test_draw(void);
+bool test_drawAll(void);
+void composeByHand(char* out, const char* seen, const char* visible, int length, int self);
+void test_speed(const char* mapFile);
+
+/**************** main ****************/
+int main(){
+    printf("===== GAME MODULE TESTS =====\n\n");
+
+    int failed = 0;
+    failed += !test_fullGame("maps/main.txt");
+    failed += !test_fullGame("maps/small.txt");
+    failed += !test_replay("maps/main.txt");
+    failed += !test_quitAndRejoin();
+    failed += !test_rejoinTaken();
+    failed += !test_gameFull();
+    failed += !test_goldBatching("maps/main.txt");
+    failed += !test_changedFramesOnly("maps/big.txt");
+    failed += !test_viewport("maps/big.txt");
+    failed += !test_overview("maps/big.txt");
+    failed += !test_hold("maps/main.txt");
+    failed += !test_draw();
+    failed += !test_drawAll();
+    test_speed("maps/main.txt");
+
+    printf("\n%d test(s) failed\n", failed);
+    return failed == 0 ? 0 : 1;
+}
+
+
+/**************** load ****************/
+/* Start a game on mapFile, or return NULL. */
+game_t* load(const char* mapFile, uint64_t seed, game_sink_t sink, void* arg) {
+    FILE *fp = fopen(mapFile, "r");
+    if (!fp) {
+        printf("Could not open %s.\n", mapFile);
+        return NULL;
+    }
+    grid_t *grid = grid_fromFile(fp);
+    fclose(fp);
+    if (grid == NULL) {
+        printf("Failed to load %s.\n", mapFile);
+        return NULL;
+    }
+    game_t *game = game_new(grid, seed, 5, sink, arg);
+    if (game == NULL) {
+        printf("Failed to start a game on %s.\n", mapFile);
+        grid_delete(grid);
+    }
+    return game;
+}
+
+
+/**************** countMessage ****************/
+/* The sink: count and hash every message, and check its type. */
+void countMessage(void* arg, int player, gameMessage_t type, const char* message) {
+    static const char *words[] = {"OK ", "GRID ", "GOLD ", "DISPLAY", "QUIT "};
+    tally_t *tally = arg;
+    tally->messages++;
+    bool overview = type == GAME_MSG_FRAME && strncmp(message, "OVERVIEW ", 9) == 0;
+    if (strncmp(message, words[type], strlen(words[type])) != 0 && !overview) {
+        tally->mistyped++;
+    }
+    if (strncmp(message, "QUIT", 4) == 0) {
+        tally->quits++;
+    }
+    tally->hash = (tally->hash ^ (uint8_t)player) * 0x100000001b3;
+    for (const char *c = message; *c != '\0'; c++) {
+        tally->hash = (tally->hash ^ (uint8_t)*c) * 0x100000001b3;
+    }
+    snprintf(tally->last, sizeof(tally->last), "%s", message);
+}
+
+
+/**************** collectGold ****************/
+/* A sink that keeps only GOLD messages. */
+void collectGold(void* arg, int player, gameMessage_t type, const char* message) {
+    goldFrame_t *frame = arg;
+    int n, p, r;
+    if (player >= 0 && sscanf(message, "GOLD %d %d %d", &n, &p, &r) == 3) {
+        frame->golds[player]++;
+        frame->pickedUp[player] = n;
+        frame->purse[player] = p;
+        frame->remaining = r;
+    }
+}
+
+
+/**************** keepFrames ****************/
+/* A sink that remembers each player's last DISPLAY and counts repeats,
+ * and keeps the spectators' last one apart. */
+void keepFrames(void* arg, int player, gameMessage_t type, const char* message) {
+    lastFrames_t *frames = arg;
+    if (type != GAME_MSG_FRAME) {
+        return;
+    }
+    if (player < 0) {
+        frames->spectatorGot++;
+        free(frames->spectator);
+        frames->spectator = malloc(strlen(message) + 1);
+        if (frames->spectator != NULL) {
+            strcpy(frames->spectator, message);
+        }
+        return;
+    }
+    frames->displays++;
+    frames->got[player]++;
+    if (frames->last[player] != NULL && strcmp(frames->last[player], message) == 0) {
+        frames->repeats++;
+    }
+    free(frames->last[player]);
+    frames->last[player] = malloc(strlen(message) + 1);
+    if (frames->last[player] != NULL) {
+        strcpy(frames->last[player], message);
+    }
+}
+
+
+/**************** keepSpectator ****************/
+/* A sink that remembers the spectators' last OVERVIEW and DISPLAY. */
+void keepSpectator(void* arg, int player, gameMessage_t type, const char* message) {
+    spectatorFeed_t *feed = arg;
+    if (player != GAME_SPECTATOR) {
+        return;
+    }
+    char **keep = NULL;
+    if (strncmp(message, "OVERVIEW", 8) == 0) {
+        keep = &feed->overview;
+    }
+    else if (strncmp(message, "DISPLAY", 7) == 0) {
+        keep = &feed->display;
+        feed->frames++;
+    }
+    if (keep != NULL) {
+        free(*keep);
+        *keep = malloc(strlen(message) + 1);
+        if (*keep != NULL) {
+            strcpy(*keep, message);
+        }
+    }
+}
+
+
+/**************** play ****************/
+/* Join players and step random keys round robin until the gold is gone
+ * (flushing a frame after every key); return the number of moves. */
+int play(game_t* game, int players, uint64_t seed) {
+    for (int p = 0; p < players; p++) {
+        char name[16];
+        snprintf(name, sizeof(name), "bot%d", p);
+        game_join(game, name);
+    }
+    game_flush(game);
+
+    rng_t *keys = rng_new(seed);
+    int moves = 0;
+    bool over = false;
+    while (!over && moves < MAX_MOVES) {
+        int player = moves % players;
+        over = game_step(game, player, KEYS[rng_below(keys, strlen(KEYS))]);
+        game_flush(game);
+        moves++;
+    }
+    rng_delete(keys);
+    return moves;
+}
+
+
+/**************** test_fullGame ****************/
+bool test_fullGame(const char* mapFile) {
+    printf("--- full game on %s ---\n", mapFile);
+    tally_t tally = {0, 0, 0xcbf29ce484222325, ""};
+    game_t *game = load(mapFile, 3, countMessage, &tally);
+    if (game == NULL) {
+        return false;
+    }
+    int moves = play(game, 4, 11);
+    int total = 0;
+    for (int p = 0; p < 4; p++) {
+        total += game_purse(game, p);
+    }
+    game_end(game);
+    printf("%d moves, %d messages (%d of the wrong type), purses total %d, %d left\n",
+           moves, tally.messages, tally.mistyped, total, game_goldRemaining(game));
+    bool ok = game_over(game) && total == 250 && game_goldRemaining(game) == 0 &&
+              tally.quits == 4 && strncmp(tally.last, "QUIT GAME OVER:", 15) == 0 && tally.mistyped == 0;
+    printf("%s\n\n", ok ? "All gold picked up, scores sent" : "FAILED");
+    game_delete(game);
+    return ok;
+}
+
+
+/**************** test_replay ****************/
+bool test_replay(const char* mapFile) {
+    printf("--- same seed replays %s ---\n", mapFile);
+    tally_t first = {0, 0, 0xcbf29ce484222325, ""};
+    tally_t second = {0, 0, 0xcbf29ce484222325, ""};
+    game_t *a = load(mapFile, 42, countMessage, &first);
+    game_t *b = load(mapFile, 42, countMessage, &second);
+    if (a == NULL || b == NULL) {
+        game_delete(a);
+        game_delete(b);
+        return false;
+    }
+    int movesA = play(a, 3, 5);
+    int movesB = play(b, 3, 5);
+    bool ok = movesA == movesB && first.messages == second.messages && first.hash == second.hash;
+    printf("%d and %d moves, %d and %d messages: %s\n\n",
+           movesA, movesB, first.messages, second.messages, ok ? "identical" : "DIFFERENT");
+    game_delete(a);
+    game_delete(b);
+    return ok;
+}
+
+
+/**************** test_quitAndRejoin ****************/
+bool test_quitAndRejoin(void) {
+    printf("--- quit and rejoin ---\n");
+    tally_t tally = {0, 0, 0xcbf29ce484222325, ""};
+    game_t *game = load("maps/main.txt", 1, countMessage, &tally);
+    if (game == NULL) {
+        return false;
+    }
+    int a = game_join(game, "alice");
+    int b = game_join(game, "bob");
+    game_flush(game);
+
+    game_step(game, b, 'Q');
+    bool quit = !game_isActive(game, b) && strcmp(tally.last, "QUIT Thanks for playing!") == 0;
+    printf("bob quits: %s\n", quit ? "yes" : "NO");
+
+    // keys from a player who quit change nothing (once the frame without them is out)
+    game_flush(game);
+    int before = tally.messages;
+    game_step(game, b, 'h');
+    game_flush(game);
+    bool ignored = tally.messages == before;
+    printf("bob's keys after quitting are ignored: %s\n", ignored ? "yes" : "NO");
+
+    int back = game_rejoin(game, b, "bobby");
+    bool rejoined = back == b && game_isActive(game, b) && game_rejoin(game, a, "eve") == -1;
+    game_flush(game);
+    printf("bob rejoins as %c, alice cannot be rejoined: %s\n", 'A' + back, rejoined ? "yes" : "NO");
+    game_delete(game);
+
+    bool gone = test_quitterGone(false) && test_quitterGone(true);
+    printf("\n");
+    return quit && ignored && rejoined && gone;
+}
+
+
+/**************** test_quitterGone ****************/
+/* In one room where everyone sees everyone, a player quits (right away,
+ * or queued for a tick): the next DISPLAY to the other player and to the
+ * spectators must not show them. */
+bool test_quitterGone(bool ticked) {
+    lastFrames_t frames;
+    memset(&frames, 0, sizeof(frames));
+    grid_t *grid = grid_new((char*)ROOM);
+    game_t *game = (grid == NULL) ? NULL : game_new(grid, 3, 20, keepFrames, &frames);
+    if (game == NULL) {
+        grid_delete(grid);
+        return false;
+    }
+    int a = game_join(game, "alice");
+    int b = game_join(game, "bob");
+    game_spectate(game, true);
+    game_flush(game);
+    const char *prefix = "DISPLAY\n";
+    bool seen = frames.last[b] != NULL && frames.spectator != NULL &&
+                strchr(frames.last[b] + strlen(prefix), 'A' + a) != NULL &&
+                strchr(frames.spectator + strlen(prefix), 'A' + a) != NULL;
+
+    int got = frames.got[b];
+    int spectatorGot = frames.spectatorGot;
+    if (ticked) {
+        game_queue(game, a, 'Q');
+        game_tick(game);
+    }
+    else {
+        game_step(game, a, 'Q');
+        game_flush(game);
+    }
+    bool gone = seen && frames.got[b] == got + 1 && frames.spectatorGot == spectatorGot + 1 &&
+                strchr(frames.last[b] + strlen(prefix), 'A' + a) == NULL &&
+                strchr(frames.spectator + strlen(prefix), 'A' + a) == NULL;
+    printf("alice quits%s: bob and the spectators see her go: %s\n", ticked ? " on a tick" : "", gone ? "yes" : "NO");
+
+    for (int p = 0; p < GAME_MAX_PLAYERS; p++) {
+        free(frames.last[p]);
+    }
+    free(frames.spectator);
+    game_delete(game);
+    return gone;
+}
+
+
+/**************** test_rejoinTaken ****************/
+/* A player who quit comes back somewhere else if another player has
+ * walked onto their spot in the meantime. One open room, so walking
+ * there is just stepping towards it. */
+bool test_rejoinTaken(void) {
+    printf("--- rejoin onto a taken spot ---\n");
+    static const char *steps = "ykuh.lbjn";     // by (row, column) change, -1 to 1
+    lastFrames_t frames;
+    memset(&frames, 0, sizeof(frames));
+    grid_t *grid = grid_new((char*)ROOM);
+    game_t *game = (grid == NULL) ? NULL : game_new(grid, 2, 5, keepFrames, &frames);
+    if (game == NULL) {
+        grid_delete(grid);
+        return false;
+    }
+    int width = grid_getWidth(grid) + 1;     // with the newline
+    int a = game_join(game, "alice");
+    int b = game_join(game, "bob");
+    game_flush(game);
+    int spot = whereAmI(&frames, b);
+    game_step(game, b, 'Q');
+
+    // alice walks over to where bob was
+    int moves = 0;
+    for (int loc = whereAmI(&frames, a); loc != spot && loc >= 0 && moves < 100; loc = whereAmI(&frames, a)) {
+        int dr = (spot / width > loc / width) - (spot / width < loc / width);
+        int dc = (spot % width > loc % width) - (spot % width < loc % width);
+        game_step(game, a, steps[(dr + 1) * 3 + dc + 1]);
+        game_flush(game);
+        moves++;
+    }
+    bool there = whereAmI(&frames, a) == spot;
+
+    int back = game_rejoin(game, b, "bobby");
+    game_flush(game);
+    int now = whereAmI(&frames, b);
+    bool moved = back == b && now >= 0 && now != spot && grid_get(grid, now) == '.' &&
+                 whereAmI(&frames, a) == spot;
+    printf("alice takes bob's spot in %d moves: %s; bob comes back elsewhere: %s\n\n",
+           moves, there ? "yes" : "NO", moved ? "yes" : "NO");
+
+    for (int p = 0; p < GAME_MAX_PLAYERS; p++) {
+        free(frames.last[p]);
+    }
+    game_delete(game);
+    return there && moved;
+}
+
+
+/**************** whereAmI ****************/
+/* Return where the player's last DISPLAY puts their '@', or -1. */
+int whereAmI(lastFrames_t* frames, int player) {
+    if (frames->last[player] == NULL) {
+        return -1;
+    }
+    const char *map = frames->last[player] + strlen("DISPLAY\n");
+    const char *self = strchr(map, '@');
+    return (self == NULL) ? -1 : self - map;
+}
+
+
+/**************** test_gameFull ****************/
+bool test_gameFull(void) {
+    printf("--- game full ---\n");
+    game_t *game = load("maps/main.txt", 1, NULL, NULL);
+    if (game == NULL) {
+        return false;
+    }
+    bool inOrder = true;
+    for (int p = 0; p < GAME_MAX_PLAYERS; p++) {
+        inOrder = inOrder && game_numPlayers(game) == p && game_join(game, "bot") == p;
+    }
+    bool full = game_join(game, "one too many") == -1;
+    printf("%d players join in order: %s; the next is turned away: %s\n\n",
+           GAME_MAX_PLAYERS, inOrder ? "yes" : "NO", full ? "yes" : "NO");
+    game_delete(game);
+    return inOrder && full;
+}
+
+
+/**************** test_goldBatching ****************/
+/* Queue a tick's worth of keys (sprints included) for every player, so
+ * several piles are picked up per tick, and check each tick sends every
+ * player at most one GOLD, with the net totals. */
+bool test_goldBatching(const char* mapFile) {
+    printf("--- one GOLD per player per tick on %s ---\n", mapFile);
+    goldFrame_t frame;
+    game_t *game = load(mapFile, 17, collectGold, &frame);
+    if (game == NULL) {
+        return false;
+    }
+    const int players = 6;
+    for (int p = 0; p < players; p++) {
+        game_join(game, "bot");
+    }
+    game_tick(game);
+
+    rng_t *keys = rng_new(23);
+    int ticks = 0;
+    int busyTicks = 0;      // ticks where more than one player picked up gold
+    int bad = 0;
+    while (!game_over(game) && ticks < 100000) {
+        int before[GAME_MAX_PLAYERS];
+        for (int p = 0; p < players; p++) {
+            before[p] = game_purse(game, p);
+        }
+        for (int p = 0; p < players; p++) {
+            for (int k = 0; k < 8; k++) {
+                game_queue(game, p, KEYS[rng_below(keys, strlen(KEYS))]);
+            }
+        }
+        memset(&frame, 0, sizeof(frame));
+        game_tick(game);
+        ticks++;
+
+        int gainers = 0;
+        bool anyGold = false;
+        for (int p = 0; p < players; p++) {
+            int delta = game_purse(game, p) - before[p];
+            gainers += (delta > 0);
+            anyGold = anyGold || frame.golds[p] > 0;
+            if (frame.golds[p] > 1 ||
+                (frame.golds[p] == 1 && (frame.pickedUp[p] != delta || frame.purse[p] != game_purse(game, p))) ||
+                (frame.golds[p] == 0 && delta != 0)) {
+                bad++;
+            }
+        }
+        if (anyGold && frame.remaining != game_goldRemaining(game)) {
+            bad++;
+        }
+        busyTicks += (gainers > 1);
+    }
+    rng_delete(keys);
+    printf("%d ticks, %d with several players picking up, %d bad: %s\n\n",
+           ticks, busyTicks, bad, bad == 0 && game_over(game) ? "one GOLD each, net totals" : "FAILED");
+    bool ok = bad == 0 && game_over(game);
+    game_delete(game);
+    return ok;
+}
+
+
+/**************** test_changedFramesOnly ****************/
+/* On a big map, most moves change nobody's view but the mover's: check
+ * nobody is sent the DISPLAY they already have, and that some are not
+ * sent at all. */
+bool test_changedFramesOnly(const char* mapFile) {
+    printf("--- DISPLAY only on change, on %s ---\n", mapFile);
+    lastFrames_t frames;
+    memset(&frames, 0, sizeof(frames));
+    game_t *game = load(mapFile, 5, keepFrames, &frames);
+    if (game == NULL) {
+        return false;
+    }
+    const int players = 8;
+    int moves = play(game, players, 19);
+    // one frame after the joins, then one per move
+    long possible = (long)(moves + 1) * players;
+    printf("%d moves, %d DISPLAYs of %ld possible, %d repeated: %s\n\n",
+           moves, frames.displays, possible, frames.repeats,
+           frames.repeats == 0 && frames.displays < possible ? "only changes sent" : "FAILED");
+    bool ok = frames.repeats == 0 && frames.displays < possible;
+    for (int p = 0; p < GAME_MAX_PLAYERS; p++) {
+        free(frames.last[p]);
+    }
+    game_delete(game);
+    return ok;
+}
+
+
+/**************** test_viewport ****************/
+/* Play two games in step, the same but that player 0 of the first has a
+ * viewport: every frame they get must be the window of the frame player 0
+ * of the second gets at the same time, with them in it. */
+bool test_viewport(const char* mapFile) {
+    const int rows = 9;
+    const int cols = 25;
+    printf("--- %dx%d viewport on %s ---\n", rows, cols, mapFile);
+    lastFrames_t windows, frames;
+    memset(&windows, 0, sizeof(windows));
+    memset(&frames, 0, sizeof(frames));
+    game_t *a = load(mapFile, 7, keepFrames, &windows);
+    game_t *b = load(mapFile, 7, keepFrames, &frames);
+    if (a == NULL || b == NULL) {
+        game_delete(a);
+        game_delete(b);
+        return false;
+    }
+    const int players = 4;
+    for (int p = 0; p < players; p++) {
+        game_join(a, "bot");
+        game_join(b, "bot");
+    }
+    bool ok = game_viewport(a, 0, rows, cols) && !game_viewport(a, players, rows, cols);
+    game_flush(a);
+    game_flush(b);
+
+    rng_t *keys = rng_new(3);
+    int moves = 0;
+    int compared = 0;
+    long windowBytes = 0, frameBytes = 0;
+    while (ok && !game_over(a) && moves < 20000) {
+        int player = moves % players;
+        char key = KEYS[rng_below(keys, strlen(KEYS))];
+        game_step(a, player, key);
+        game_step(b, player, key);
+        game_flush(a);
+        game_flush(b);
+        moves++;
+        // the windows go out exactly when the whole frames do
+        if (windows.got[0] != frames.got[0]) {
+            ok = false;
+        }
+        else if (windows.got[0] > compared) {
+            compared = windows.got[0];
+            ok = sameWindow(windows.last[0], frames.last[0], rows, cols, true);
+            windowBytes += strlen(windows.last[0]);
+            frameBytes += strlen(frames.last[0]);
+        }
+    }
+    rng_delete(keys);
+    printf("%d moves, %d of player 0's frames compared, %ld bytes instead of %ld: %s\n\n",
+           moves, compared, windowBytes, frameBytes, ok && compared > 0 ? "same windows" : "FAILED");
+    for (int p = 0; p < GAME_MAX_PLAYERS; p++) {
+        free(windows.last[p]);
+        free(frames.last[p]);
+    }
+    game_delete(a);
+    game_delete(b);
+    return ok && compared > 0;
+}
+
+
+/**************** test_hold ****************/
+/* Play two games in step, but in the first hold player 0 for nine moves
+ * in ten: they must get nothing while held, and on the flush that lets
+ * them go, just the frame player 0 of the second game has by then. */
+bool test_hold(const char* mapFile) {
+    printf("--- holding frames on %s ---\n", mapFile);
+    lastFrames_t held, frames;
+    memset(&held, 0, sizeof(held));
+    memset(&frames, 0, sizeof(frames));
+    game_t *a = load(mapFile, 11, keepFrames, &held);
+    game_t *b = load(mapFile, 11, keepFrames, &frames);
+    if (a == NULL || b == NULL) {
+        game_delete(a);
+        game_delete(b);
+        return false;
+    }
+    const int players = 3;
+    for (int p = 0; p < players; p++) {
+        game_join(a, "bot");
+        game_join(b, "bot");
+    }
+    game_flush(a);
+    game_flush(b);
+
+    rng_t *keys = rng_new(5);
+    int moves = 0;
+    int released = 0;
+    bool ok = true;
+    while (ok && !game_over(a) && moves < 20000) {
+        int player = moves % players;
+        char key = KEYS[rng_below(keys, strlen(KEYS))];
+        game_hold(a, 0, true);
+        int before = held.got[0];
+        game_step(a, player, key);
+        game_step(b, player, key);
+        game_flush(a);
+        game_flush(b);
+        moves++;
+        // held: nothing for player 0, everyone else as usual
+        ok = held.got[0] == before && held.got[1] == frames.got[1] && held.got[2] == frames.got[2];
+        if (ok && moves % 10 == 0) {
+            // let go, with no move: one frame if anything changed, and it is the latest
+            game_hold(a, 0, false);
+            game_flush(a);
+            if (held.got[0] > before) {
+                released++;
+                ok = held.got[0] == before + 1 && strcmp(held.last[0], frames.last[0]) == 0;
+            }
+        }
+    }
+    rng_delete(keys);
+    ok = ok && released > 0 && held.got[0] < frames.got[0];
+    printf("%d moves, player 0 sent %d frames instead of %d, %d on release: %s\n\n",
+           moves, held.got[0], frames.got[0], released, ok ? "latest frames only" : "FAILED");
+    for (int p = 0; p < GAME_MAX_PLAYERS; p++) {
+        free(held.last[p]);
+        free(frames.last[p]);
+    }
+    game_delete(a);
+    game_delete(b);
+    return ok;
+}
+
+
+/**************** test_overview ****************/
+/* Play two games in step, spectated, the first with an overview and a
+ * region: after every move its overview must be the second's whole map
+ * scaled down, and its region that part of it. */
+bool test_overview(const char* mapFile) {
+    const int scale = 3;
+    printf("--- 1:%d spectator overview on %s ---\n", scale, mapFile);
+    spectatorFeed_t small, whole;
+    memset(&small, 0, sizeof(small));
+    memset(&whole, 0, sizeof(whole));
+    game_t *a = load(mapFile, 11, keepSpectator, &small);
+    game_t *b = load(mapFile, 11, keepSpectator, &whole);
+    if (a == NULL || b == NULL) {
+        game_delete(a);
+        game_delete(b);
+        return false;
+    }
+    const int players = 6;
+    for (int p = 0; p < players; p++) {
+        game_join(a, "bot");
+        game_join(b, "bot");
+    }
+    bool ok = game_spectatorOverview(a, scale) && game_spectatorRegion(a, 5, 100, 12, 80) &&
+              !game_spectatorOverview(a, 0) && !game_spectatorRegion(a, -1, 0, 5, 5);
+    game_spectate(a, true);
+    game_spectate(b, true);
+    game_flush(a);
+    game_flush(b);
+
+    rng_t *keys = rng_new(8);
+    int moves = 0;
+    int frames = 0;
+    while (ok && !game_over(a) && moves < 5000) {
+        int player = moves % players;
+        char key = KEYS[rng_below(keys, strlen(KEYS))];
+        game_step(a, player, key);
+        game_step(b, player, key);
+        game_flush(a);
+        game_flush(b);
+        moves++;
+        // the region is cut off at the right of the map: 46 of 80 columns
+        ok = small.frames == whole.frames && sameOverview(small.overview, whole.display, scale) &&
+             sameWindow(small.display, whole.display, 12, 46, false);
+        frames = whole.frames;
+    }
+    rng_delete(keys);
+    printf("%d moves, %d frames, %d + %d bytes instead of %d: %s\n\n", moves, frames,
+           small.overview ? (int)strlen(small.overview) : 0, small.display ? (int)strlen(small.display) : 0,
+           whole.display ? (int)strlen(whole.display) : 0, ok ? "overview and region match" : "FAILED");
+    free(small.overview);
+    free(small.display);
+    free(whole.overview);
+    free(whole.display);
+    game_delete(a);
+    game_delete(b);
+    return ok;
+}
+
+
+/**************** sameOverview ****************/
+/* Return true if overview is "OVERVIEW scale" then the whole DISPLAY
+ * frame scaled down: in each block, the first of its most telling chars
+ * (players, gold, floor, passage, wall, blank). */
+bool sameOverview(const char* overview, const char* frame, int scale) {
+    int given, used;
+    if (overview == NULL || frame == NULL || sscanf(overview, "OVERVIEW %d%n", &given, &used) != 1 ||
+        given != scale || overview[used++] != '\n') {
+        return false;
+    }
+    const char *map = frame + strlen("DISPLAY\n");
+    int width = strchr(map, '\n') - map;
+    int height = strlen(map) / (width + 1);
+    const char *cell = overview + used;
+    for (int top = 0; top < height; top += scale) {
+        for (int left = 0; left < width; left += scale) {
+            char best = ' ';
+            int bestRank = 0;
+            for (int r = top; r < top + scale && r < height; r++) {
+                for (int c = left; c < left + scale && c < width; c++) {
+                    char ch = map[r * (width + 1) + c];
+                    int rank = (ch >= 'A' && ch <= 'Z') ? 5 : ch == '*' ? 4 : ch == '.' ? 3 :
+                               ch == '#' ? 2 : ch == ' ' ? 0 : 1;
+                    if (rank > bestRank) {
+                        best = ch;
+                        bestRank = rank;
+                    }
+                }
+            }
+            if (*cell++ != best) {
+                return false;
+            }
+        }
+        if (*cell++ != '\n') {
+            return false;
+        }
+    }
+    return *cell == '\0';
+}
+
+
+/**************** sameWindow ****************/
+/* Return true if window is "DISPLAY top left" then rows lines of cols
+ * chars, holding '@' if a player's, which are that window of the whole
+ * DISPLAY frame. */
+bool sameWindow(const char* window, const char* frame, int rows, int cols, bool mine) {
+    int top, left, used;
+    if (window == NULL || frame == NULL ||
+        sscanf(window, "DISPLAY %d %d%n", &top, &left, &used) != 2 || window[used++] != '\n' ||
+        (mine && strchr(window, '@') == NULL) || (int)strlen(window + used) != rows * (cols + 1)) {
+        return false;
+    }
+    const char *map = frame + strlen("DISPLAY\n");
+    const char *rowEnd = strchr(map, '\n');
+    if (rowEnd == NULL) {
+        return false;
+    }
+    int stride = rowEnd - map + 1;
+    for (int r = 0; r < rows; r++) {
+        const char *line = window + used + r * (cols + 1);
+        if (memcmp(line, map + (top + r) * stride + left, cols) != 0 || line[cols] != '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**************** test_draw ****************/
+/* Draw random backgrounds of every length up to a few hundred cells, at
+ * every offset, with random sprites (some off the frame, some on top of
+ * one another), and check each cell: the last sprite there, or else the
+ * background, and nothing written outside the frame. */
+bool test_draw(void) {
+    printf("--- frame_draw ---\n");
+    static const char CELLS[] = " .#-|+*ABZ@[`az\n\x80\xff";
+    enum { MAX_LEN = 200, MAX_SPRITES = 12 };
+    char seen[MAX_LEN + 1], want[MAX_LEN + 1], out[MAX_LEN + 1];
+    sprite_t sprites[MAX_SPRITES];
+    rng_t *rng = rng_new(31);
+    int bad = 0;
+    int frames = 0;
+    for (int length = 1; length <= MAX_LEN - 8; length++) {
+        for (int offset = 0; offset < 8; offset++) {
+            for (int i = 0; i < MAX_LEN; i++) {
+                seen[i] = CELLS[rng_below(rng, sizeof(CELLS) - 1)];
+            }
+            int count = (int)rng_below(rng, MAX_SPRITES + 1);
+            memcpy(want, seen + offset, length);
+            for (int i = 0; i < count; i++) {
+                sprites[i].loc = (int)rng_below(rng, length + 4) - 2;
+                sprites[i].c = "*AMZ@"[rng_below(rng, 5)];
+                if (sprites[i].loc >= 0 && sprites[i].loc < length) {
+                    want[sprites[i].loc] = sprites[i].c;
+                }
+            }
+            memset(out, '?', sizeof(out));
+            frame_draw(out + offset, seen + offset, length, sprites, count);
+            frames++;
+            for (int i = 0; i < length; i++) {
+                bad += out[offset + i] != want[i];
+            }
+            bad += out[offset + length] != '?' || (offset > 0 && out[offset - 1] != '?');
+        }
+    }
+    rng_delete(rng);
+    printf("%d frames, %d wrong cells: %s\n\n", frames, bad, bad == 0 ? "all match" : "FAILED");
+    return bad == 0;
+}
+
+
+/**************** test_drawAll ****************/
+/* Draw batches of random frames, some big enough to be split into
+ * blocks, on a pool of three workers. Each frame's sprites are the cells
+ * where a random visible layer has gold or a player, and an '@': every
+ * frame must match the two layers composed cell by cell, with nothing
+ * written past it. */
+bool test_drawAll(void) {
+    enum { JOBS = 8, MAX_LEN = 150000, MAX_SPRITES = 64 };
+    printf("--- frame_drawAll on a pool of 3 ---\n");
+    framePool_t *pool = frame_newPool(3);
+    char *seen = malloc(MAX_LEN);
+    char *visible = malloc(MAX_LEN);
+    char *out = malloc((size_t)JOBS * (MAX_LEN + 1));
+    char *want = malloc(MAX_LEN);
+    if (pool == NULL || seen == NULL || visible == NULL || out == NULL || want == NULL) {
+        frame_deletePool(pool);
+        free(seen);
+        free(visible);
+        free(out);
+        free(want);
+        return false;
+    }
+    rng_t *rng = rng_new(37);
+    for (int i = 0; i < MAX_LEN; i++) {
+        seen[i] = " .#"[rng_below(rng, 3)];
+        visible[i] = seen[i];
+    }
+
+    int bad = 0;
+    int frames = 0;
+    for (int round = 0; round < 40; round++) {
+        // every job draws from the same background, at its own offset, with its own sprites
+        frameJob_t jobs[JOBS];
+        sprite_t sprites[JOBS][MAX_SPRITES];
+        int self[JOBS];
+        int from[JOBS];
+        int count = 1 + (int)rng_below(rng, JOBS);
+        for (int j = 0; j < count; j++) {
+            int length = (int)rng_below(rng, round % 2 ? MAX_LEN : 2000);
+            from[j] = (int)rng_below(rng, MAX_LEN - length + 1);
+            self[j] = (int)rng_below(rng, length + 1) - 1;
+            int n = 0;
+            while (length > 0 && n < MAX_SPRITES - 1 && rng_below(rng, 8) != 0) {
+                sprites[j][n].loc = (int)rng_below(rng, length);
+                sprites[j][n].c = "*AMZ"[rng_below(rng, 4)];
+                n++;
+            }
+            if (self[j] >= 0) {
+                sprites[j][n].loc = self[j];
+                sprites[j][n].c = '@';
+                n++;
+            }
+            jobs[j].out = out + (size_t)j * (MAX_LEN + 1);
+            jobs[j].background = seen + from[j];
+            jobs[j].length = length;
+            jobs[j].sprites = sprites[j];
+            jobs[j].count = n;
+            memset(jobs[j].out, '?', MAX_LEN + 1);
+        }
+        frame_drawAll(pool, jobs, count);
+        for (int j = 0; j < count; j++) {
+            // the same sprites on the visible layer, composed the old way
+            for (int i = 0; i < jobs[j].count; i++) {
+                if (sprites[j][i].c != '@') {
+                    visible[from[j] + sprites[j][i].loc] = sprites[j][i].c;
+                }
+            }
+            composeByHand(want, seen + from[j], visible + from[j], jobs[j].length, self[j]);
+            bad += memcmp(jobs[j].out, want, jobs[j].length) != 0 || jobs[j].out[jobs[j].length] != '?';
+            for (int i = 0; i < jobs[j].count; i++) {
+                visible[from[j] + sprites[j][i].loc] = seen[from[j] + sprites[j][i].loc];
+            }
+            frames++;
+        }
+    }
+    rng_delete(rng);
+    printf("%d frames on %d workers, %d wrong: %s\n\n", frames, frame_poolWorkers(pool), bad,
+           bad == 0 ? "all match" : "FAILED");
+    frame_deletePool(pool);
+    free(seen);
+    free(visible);
+    free(out);
+    free(want);
+    return bad == 0;
+}
+
+
+/**************** composeByHand ****************/
+/* Fill out with seen, except visible's char where it is '*' or a capital
+ * letter, and '@' at self (if not -1): what a player's frame shows. */
+void composeByHand(char* out, const char* seen, const char* visible, int length, int self) {
+    for (int i = 0; i < length; i++) {
+        char c = visible[i];
+        out[i] = (c == '*' || (c >= 'A' && c <= 'Z')) ? c : seen[i];
+    }
+    if (self >= 0 && self < length) {
+        out[self] = '@';
+    }
+}
+
+
+/**************** test_speed ****************/
+/* No sink, so nothing is rendered: just the rules. */
+void test_speed(const char* mapFile) {
+    printf("--- headless speed on %s ---\n", mapFile);
+    game_t *game = load(mapFile, 9, NULL, NULL);
+    if (game == NULL) {
+        return;
+    }
+    // every visible set looked up, as a simulation would run it
+    visibility_setStrategy(game_visibility(game), VIS_STRATEGY_TABLE, 0);
+    clock_t start = clock();
+    int moves = play(game, 8, 13);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%d moves in %.3f s (%.0f moves/s)\n", moves, seconds, seconds > 0 ? moves / seconds : 0.0);
+    game_delete(game);
+}
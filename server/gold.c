@@ -0,0 +1,201 @@
+/*
+ * gold.c - implementation file for gold module
+ *
+ * Dense array of piles plus a per-cell overlay of pile ids.
+ * See gold.h for more information.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "gold.h"
+#include "grid.h"
+#include "../libcs50/hashtable.h"
+
+/**************** file-local global variables ****************/
+/* none */
+
+/**************** local types ****************/
+typedef struct pile {
+    int index;      // where the pile is
+    int amount;     // nuggets in it
+    bool taken;     // picked up already
+} pile_t;
+
+/**************** global types ****************/
+typedef struct gold {
+    pile_t* piles;      // every pile, in map order
+    int numPiles;
+    int pilesLeft;      // piles not yet taken
+    int* pileAt;        // per cell: index into piles, or -1
+    int length;         // cells in pileAt
+    int remaining;      // nuggets not yet taken
+    int pickedUp;       // nuggets taken
+} gold_t;
+
+/**************** local functions ****************/
+static void overlayPile(void* arg, const char* key, void* item);
+static void freeAmount(void* item);
+
+
+/**************** gold_new ****************/
+/* Place gold in grid and build the store.
+ * See gold.h for more information. */
+gold_t* gold_new(grid_t* grid, rng_t* rng, int minPiles, int maxPiles, int totGold)
+{
+    // validate parameters
+    if (grid == NULL){
+        fprintf(stderr, "Error: NULL grid in gold_new\n");
+        return NULL;
+    }
+
+    gold_t* gold = calloc(1, sizeof(gold_t));
+    if (gold == NULL){
+        fprintf(stderr, "Error: issue allocating memory in gold_new\n");
+        return NULL;
+    }
+    gold->length = grid_getLength(grid);
+    gold->pileAt = malloc((gold->length + 1) * sizeof(int));
+    if (gold->pileAt == NULL){
+        fprintf(stderr, "Error: issue allocating memory in gold_new\n");
+        gold_delete(gold);
+        return NULL;
+    }
+
+    // placement stays in the grid module; its hashtable is only read here
+    hashtable_t* placed = grid_makeGold(grid, rng, minPiles, maxPiles, totGold);
+    if (placed == NULL){
+        gold_delete(gold);
+        return NULL;
+    }
+
+    // amounts go into the overlay first, then move into the pile array
+    for (int i = 0; i < gold->length; i++){
+        gold->pileAt[i] = 0;
+    }
+    hashtable_iterate(placed, gold, overlayPile);
+    hashtable_delete(placed, freeAmount);
+
+    gold->piles = malloc((gold->numPiles + 1) * sizeof(pile_t));
+    if (gold->piles == NULL){
+        fprintf(stderr, "Error: issue allocating memory in gold_new\n");
+        gold_delete(gold);
+        return NULL;
+    }
+    int n = 0;
+    for (int i = 0; i < gold->length; i++){
+        int amount = gold->pileAt[i];
+        gold->pileAt[i] = -1;
+        if (amount > 0){
+            gold->piles[n].index = i;
+            gold->piles[n].amount = amount;
+            gold->piles[n].taken = false;
+            gold->pileAt[i] = n++;
+            gold->remaining += amount;
+        }
+    }
+    gold->numPiles = n;
+    gold->pilesLeft = n;
+    return gold;
+}
+
+
+/**************** gold_pickUp ****************/
+/* Take the pile at index.
+ * See gold.h for more information. */
+int gold_pickUp(gold_t* gold, int index)
+{
+    int amount = gold_amountAt(gold, index);
+    if (amount > 0){
+        gold->piles[gold->pileAt[index]].taken = true;
+        gold->pilesLeft--;
+        gold->remaining -= amount;
+        gold->pickedUp += amount;
+    }
+    return amount;
+}
+
+
+/**************** gold_amountAt ****************/
+/* Return the amount of the pile still at index.
+ * See gold.h for more information. */
+int gold_amountAt(gold_t* gold, int index)
+{
+    if (gold == NULL || index < 0 || index >= gold->length || gold->pileAt[index] < 0){
+        return 0;
+    }
+    pile_t* pile = &gold->piles[gold->pileAt[index]];
+    return pile->taken ? 0 : pile->amount;
+}
+
+
+/**************** gold_remaining ****************/
+/* Return the number of nuggets left.
+ * See gold.h for more information. */
+int gold_remaining(gold_t* gold)
+{
+    return (gold == NULL) ? 0 : gold->remaining;
+}
+
+
+/**************** gold_pickedUp ****************/
+/* Return the number of nuggets taken.
+ * See gold.h for more information. */
+int gold_pickedUp(gold_t* gold)
+{
+    return (gold == NULL) ? 0 : gold->pickedUp;
+}
+
+
+/**************** gold_numPiles ****************/
+/* Return the number of piles, and how many are left.
+ * See gold.h for more information. */
+int gold_numPiles(gold_t* gold, int* pilesLeft)
+{
+    if (gold == NULL){
+        return 0;
+    }
+    if (pilesLeft != NULL){
+        *pilesLeft = gold->pilesLeft;
+    }
+    return gold->numPiles;
+}
+
+
+/**************** gold_delete ****************/
+/* Free the store.
+ * See gold.h for more information. */
+void gold_delete(gold_t* gold)
+{
+    if (gold == NULL){
+        return;
+    }
+    free(gold->piles);
+    free(gold->pileAt);
+    free(gold);
+}
+
+
+/**************** overlayPile ****************/
+/* hashtable_iterate helper: write a placed pile's amount into the
+ * overlay and count it. */
+static void overlayPile(void* arg, const char* key, void* item)
+{
+    gold_t* gold = arg;
+    int index = atoi(key);
+    int amount = *(int*)item;
+    if (index >= 0 && index < gold->length && amount > 0){
+        gold->pileAt[index] = amount;
+        gold->numPiles++;
+    }
+}
+
+
+/**************** freeAmount ****************/
+static void freeAmount(void* item)
+{
+    free(item);
+}
@@ -0,0 +1,80 @@
+/*
+ * gold.h - header file for gold module
+ *
+ * The gold store keeps every pile of a game in a dense array, plus an
+ * overlay with the pile at each cell of the map, so finding a pile,
+ * picking it up and asking how much gold is left are all O(1).
+ *
+ * Cells are indices into the map string, like the grid module.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#ifndef __GOLD_H
+#define __GOLD_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "grid.h"
+#include "rng.h"
+
+
+/**************** global types ****************/
+typedef struct gold gold_t;
+
+
+/**************** functions ****************/
+
+/**************** gold_new ****************/
+/* Place piles of gold in grid (see grid_makeGold, which does the random
+ * placement with numbers from rng) and return a store holding them.
+ *
+ * Notes:
+ *   every pile is marked '*' in grid
+ *   returns NULL on any error
+ *   caller is responsible for calling gold_delete
+ *
+ * place the gold with grid_makeGold
+ * mark each pile's cell in the overlay
+ * copy the piles into the dense array, in map order
+ * total the gold placed
+ */
+gold_t* gold_new(grid_t* grid, rng_t* rng, int minPiles, int maxPiles, int totGold);
+
+
+/**************** gold_pickUp ****************/
+/* Take the pile at index, if there is one left there, and return its
+ * amount; return 0 if there is none.
+ * The caller is responsible for putting floor back in the map.
+ */
+int gold_pickUp(gold_t* gold, int index);
+
+
+/**************** gold_amountAt ****************/
+/* Return the amount of the pile still at index, or 0 if there is none. */
+int gold_amountAt(gold_t* gold, int index);
+
+
+/**************** gold_remaining ****************/
+/* Return the number of nuggets not yet picked up. */
+int gold_remaining(gold_t* gold);
+
+
+/**************** gold_pickedUp ****************/
+/* Return the number of nuggets picked up so far. */
+int gold_pickedUp(gold_t* gold);
+
+
+/**************** gold_numPiles ****************/
+/* Return the number of piles placed, and through pilesLeft (if not NULL)
+ * how many have not been picked up.
+ */
+int gold_numPiles(gold_t* gold, int* pilesLeft);
+
+
+/**************** gold_delete ****************/
+/* Free the store. */
+void gold_delete(gold_t* gold);
+
+#endif // __GOLD_H
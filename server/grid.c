@@ -26,6 +26,7 @@ typedef struct grid {
     char* map;
     int width;
     int height;
+    int length;     // strlen(map), cached so lookups don't rescan
 } grid_t;
 
 /**************** functions ****************/
@@ -62,6 +63,7 @@ grid_t* grid_new(char* string)
     strcpy(temp, string);
     // set grid->map
     grid->map = temp;
+    grid->length = strlen(temp);
 
     // loop through to find grid's width (first occurance of '\n')
     // also stop if you reach end of grid->map
@@ -174,7 +176,7 @@ char grid_get(grid_t* grid, int index)
         return '\0';
     }
     // validate bounds
-    if (index < 0 || index > (strlen(grid->map) - 1)){
+    if (index < 0 || index >= grid->length){
         fprintf(stderr, "Error: %d index out of bounds in grid_get\n", index);
         return '\0';
     }
@@ -194,7 +196,7 @@ bool grid_set(grid_t* grid, int index, char character)
         return false;
     }
     // validate bounds
-    if (index < 0 || index > (strlen(grid->map) - 1)){
+    if (index < 0 || index >= grid->length){
         fprintf(stderr, "Error: %d index out of bounds in grid_set\n", index);
         return false;
     }
@@ -270,9 +272,10 @@ void grid_print(grid_t* grid)
 /* Place piles of gold in grid.
  * The number of gold piles should fall in between minPiles and maxPiles.
  * The amount of golf placed should be totGold.
+ * Random numbers come from rng.
  * Return a hashtable mapping goldIndices-goldAmount.
  * See grid.h for more information. */
-hashtable_t* grid_makeGold(grid_t* grid, int minPiles, int maxPiles, int totGold)
+hashtable_t* grid_makeGold(grid_t* grid, rng_t* rng, int minPiles, int maxPiles, int totGold)
 {
 
     // count number of available '.' positions
@@ -303,7 +306,7 @@ hashtable_t* grid_makeGold(grid_t* grid, int minPiles, int maxPiles, int totGold
     while (goldPlaced < totGold && numPiles < maxPiles){
 
         // create random index
-        int randIndex = rand() % (strlen(grid->map));
+        int randIndex = rng_below(rng, strlen(grid->map));
 
         // make sure its a period
         if (grid->map[randIndex] != '.'){
@@ -313,7 +316,7 @@ hashtable_t* grid_makeGold(grid_t* grid, int minPiles, int maxPiles, int totGold
         ///// char at randIndex is '.' /////
 
         // calculate random amount of gold on interval [totGold/maxPiles, totGold/minPiles]
-        int randAmount = (totGold/maxPiles) + rand() % ((totGold/minPiles) - (totGold/maxPiles) + 1);
+        int randAmount = (totGold/maxPiles) + rng_below(rng, (totGold/minPiles) - (totGold/maxPiles) + 1);
 
         // validate you won't go over totGold
         if (goldPlaced + randAmount > totGold){
@@ -454,6 +457,6 @@ int grid_getLength(grid_t* grid)
         fprintf(stderr, "Error: NULL grid or grid->map in grid_getLength\n");
         return 0;
     }
-    // otherwise return strlen(grid->map)
-    return strlen(grid->map);
+    // otherwise return strlen(grid->map), cached in grid_new
+    return grid->length;
 }
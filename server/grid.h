@@ -7,12 +7,16 @@
  * CS 50 Nuggets
 */
 
+#ifndef __GRID_H
+#define __GRID_H
+
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
 #include <stdbool.h>
 #include "../libcs50/hashtable.h"
 #include "../libcs50/file.h"
+#include "rng.h"
 
 
 /**************** global types ****************/
@@ -138,6 +142,7 @@ void grid_print(grid_t* grid);
 /* Place piles of gold in grid.
  * The number of gold piles should fall in between minPiles and maxPiles.
  * The amount of golf placed should be totGold.
+ * Random numbers come from rng.
  * Return a hashtable mapping goldIndices-goldAmount.
  * 
  * Notes:
@@ -159,7 +164,7 @@ void grid_print(grid_t* grid);
  *   update goldPlaced
  * return hashtable
  */
-hashtable_t* grid_makeGold(grid_t* grid, int minPiles, int maxPiles, int totGold);
+hashtable_t* grid_makeGold(grid_t* grid, rng_t* rng, int minPiles, int maxPiles, int totGold);
 
 
 /**************** grid_makeEmpty ****************/
@@ -216,3 +221,5 @@ char* grid_getMap(grid_t* grid);
  * return strlen(grid->map)
  */
 int grid_getLength(grid_t* grid);
+
+#endif // __GRID_H
@@ -63,7 +63,8 @@ void test_grid(grid_t *grid) {
     printf("\n\n");
     
     printf("--- Testing grid_makeGold() ---\n");
-    hashtable_t* goldMap = grid_makeGold(grid, 10, 30, 250);
+    rng_t* rng = rng_new(1);
+    hashtable_t* goldMap = grid_makeGold(grid, rng, 10, 30, 250);
     if (goldMap) {
         printf("Gold placement successful!\n");
     } else {
@@ -72,7 +73,25 @@ void test_grid(grid_t *grid) {
     hashtable_print(goldMap, stdout, hashtablePrintHelp);
     grid_print(grid);
     hashtable_delete(goldMap, hashtableDeleteHelp);
+    rng_delete(rng);
     printf("\n\n");
+
+    printf("--- Testing rng_new() and rng_below() ---\n");
+    rng_t* first = rng_new(42);
+    rng_t* second = rng_new(42);
+    bool same = true;
+    bool inRange = true;
+    for (int i = 0; i < 1000; i++) {
+        uint32_t a = rng_below(first, 17);
+        uint32_t b = rng_below(second, 17);
+        same = same && a == b;
+        inRange = inRange && a < 17;
+    }
+    printf("Same seed gives same numbers: %s\n", same ? "yes" : "NO");
+    printf("Numbers stay below the bound: %s\n", inRange ? "yes" : "NO");
+    rng_delete(first);
+    rng_delete(second);
+    printf("\n");
     
     printf("--- Testing grid_numGoldPiles() ---\n");
     printf("Number of gold piles: %d\n\n", grid_numGoldPiles(grid));
@@ -0,0 +1,167 @@
+/*
+ * moves.c - implementation file for moves module
+ *
+ * Two tables of MOVES_DIRECTIONS ints per cell, direction fastest.
+ * See moves.h for more information.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "moves.h"
+#include "grid.h"
+
+/**************** file-local global variables ****************/
+static const char* KEYS = "hjklyubn";
+static const char* SPRINT_KEYS = "HJKLYUBN";
+static const int DROW[MOVES_DIRECTIONS] = {0, 1, -1, 0, -1, -1, 1, 1};
+static const int DCOL[MOVES_DIRECTIONS] = {-1, 0, 0, 1, -1, 1, -1, 1};
+
+/**************** global types ****************/
+typedef struct moves {
+    int length;     // cells in the map
+    int* step;      // per cell and direction: neighbour, or -1
+    int* sprint;    // per cell and direction: where a sprint ends, or -1
+} moves_t;
+
+/**************** local functions ****************/
+static bool isOpen(char c);
+
+
+/**************** moves_new ****************/
+/* Build the movement tables for grid.
+ * See moves.h for more information. */
+moves_t* moves_new(grid_t* grid)
+{
+    // validate parameters
+    if (grid == NULL || grid_getMap(grid) == NULL){
+        fprintf(stderr, "Error: NULL grid in moves_new\n");
+        return NULL;
+    }
+
+    moves_t* moves = calloc(1, sizeof(moves_t));
+    if (moves == NULL){
+        fprintf(stderr, "Error: issue allocating memory in moves_new\n");
+        return NULL;
+    }
+    const char* map = grid_getMap(grid);
+    int length = grid_getLength(grid);
+    int stride = grid_getWidth(grid) + 1;   // each row ends in '\n'
+    int rows = (length + stride - 1) / stride;
+    moves->length = length;
+    moves->step = malloc(((size_t)length * MOVES_DIRECTIONS + 1) * sizeof(int));
+    moves->sprint = malloc(((size_t)length * MOVES_DIRECTIONS + 1) * sizeof(int));
+    if (moves->step == NULL || moves->sprint == NULL){
+        fprintf(stderr, "Error: issue allocating memory in moves_new\n");
+        moves_delete(moves);
+        return NULL;
+    }
+
+    // one step in every direction, checked against the rows and columns
+    for (int loc = 0; loc < length; loc++){
+        int row = loc / stride;
+        int col = loc % stride;
+        for (int d = 0; d < MOVES_DIRECTIONS; d++){
+            int r = row + DROW[d];
+            int c = col + DCOL[d];
+            int next = r * stride + c;
+            bool inside = r >= 0 && r < rows && c >= 0 && c < stride - 1 && next < length;
+            moves->step[loc * MOVES_DIRECTIONS + d] =
+                (isOpen(map[loc]) && inside && isOpen(map[next])) ? next : -1;
+        }
+    }
+
+    // a sprint goes one step, then on as far as a sprint from there does;
+    // visit cells so that the next one along has already been filled in
+    for (int d = 0; d < MOVES_DIRECTIONS; d++){
+        bool forward = DROW[d] * stride + DCOL[d] > 0;
+        for (int i = 0; i < length; i++){
+            int loc = forward ? length - 1 - i : i;
+            int next = moves->step[loc * MOVES_DIRECTIONS + d];
+            if (!isOpen(map[loc])){
+                moves->sprint[loc * MOVES_DIRECTIONS + d] = -1;
+            }
+            else if (next < 0){
+                moves->sprint[loc * MOVES_DIRECTIONS + d] = loc;
+            }
+            else{
+                moves->sprint[loc * MOVES_DIRECTIONS + d] = moves->sprint[next * MOVES_DIRECTIONS + d];
+            }
+        }
+    }
+    return moves;
+}
+
+
+/**************** moves_direction ****************/
+/* Return the direction of a movement key.
+ * See moves.h for more information. */
+int moves_direction(char key, bool* sprint)
+{
+    const char* found = NULL;
+    bool isSprint = false;
+    if (key != '\0'){
+        found = strchr(KEYS, key);
+        if (found == NULL){
+            found = strchr(SPRINT_KEYS, key);
+            isSprint = (found != NULL);
+        }
+    }
+    if (sprint != NULL){
+        *sprint = isSprint;
+    }
+    if (found == NULL){
+        return -1;
+    }
+    return isSprint ? found - SPRINT_KEYS : found - KEYS;
+}
+
+
+/**************** moves_step ****************/
+/* Return the cell one step from loc.
+ * See moves.h for more information. */
+int moves_step(moves_t* moves, int loc, int direction)
+{
+    if (moves == NULL || loc < 0 || loc >= moves->length || direction < 0 || direction >= MOVES_DIRECTIONS){
+        return -1;
+    }
+    return moves->step[loc * MOVES_DIRECTIONS + direction];
+}
+
+
+/**************** moves_sprint ****************/
+/* Return the cell a sprint from loc ends on.
+ * See moves.h for more information. */
+int moves_sprint(moves_t* moves, int loc, int direction)
+{
+    if (moves == NULL || loc < 0 || loc >= moves->length || direction < 0 || direction >= MOVES_DIRECTIONS){
+        return -1;
+    }
+    return moves->sprint[loc * MOVES_DIRECTIONS + direction];
+}
+
+
+/**************** moves_delete ****************/
+/* Free the tables.
+ * See moves.h for more information. */
+void moves_delete(moves_t* moves)
+{
+    if (moves == NULL){
+        return;
+    }
+    free(moves->step);
+    free(moves->sprint);
+    free(moves);
+}
+
+
+/**************** isOpen ****************/
+/* Return true if a player can stand on a cell holding c. */
+static bool isOpen(char c)
+{
+    return c == '.' || c == '#' || c == '*';
+}
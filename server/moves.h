@@ -0,0 +1,82 @@
+/*
+ * moves.h - header file for moves module
+ *
+ * Movement tables for one map, built once when the map is loaded. For
+ * every cell and each of the eight directions they hold the neighbour a
+ * step leads to (or -1 if it is blocked) and the cell a sprint ends on,
+ * so a move or a sprint is a single table lookup.
+ *
+ * Cells are indices into the map string, like the grid module.
+ * Directions are numbered by their key in "hjklyubn":
+ *
+ *   y k u        4 2 5
+ *   h @ l        0 @ 3
+ *   b j n        6 1 7
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#ifndef __MOVES_H
+#define __MOVES_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "grid.h"
+
+
+/**************** global types ****************/
+typedef struct moves moves_t;
+
+#define MOVES_DIRECTIONS 8
+
+
+/**************** functions ****************/
+
+/**************** moves_new ****************/
+/* Build the movement tables for grid.
+ *
+ * Notes:
+ *   a player can stand on floor, passages and gold ('.', '#', '*');
+ *     everything else, and anything off the map, blocks
+ *   steps never wrap from one row to the next
+ *   only the terrain matters, so the tables stay valid as gold is taken
+ *   returns NULL on any error
+ *   caller is responsible for calling moves_delete
+ *
+ * validate grid
+ * for every open cell, record each open neighbour
+ * for every direction, walk the cells so each one's neighbour in that
+ *   direction is done first, and extend the neighbour's sprint
+ */
+moves_t* moves_new(grid_t* grid);
+
+
+/**************** moves_direction ****************/
+/* Return the direction of a movement key (0 to 7, see above), or -1 if
+ * key is not one. Capital keys are sprints: *sprint is set to whether
+ * key was one, if sprint is not NULL.
+ */
+int moves_direction(char key, bool* sprint);
+
+
+/**************** moves_step ****************/
+/* Return the cell one step from loc in direction, or -1 if that cell is
+ * blocked or loc is not a cell a player can stand on.
+ */
+int moves_step(moves_t* moves, int loc, int direction);
+
+
+/**************** moves_sprint ****************/
+/* Return the last open cell reached by stepping from loc in direction
+ * until blocked; that is loc itself if the first step is blocked.
+ * Return -1 if loc is not a cell a player can stand on.
+ */
+int moves_sprint(moves_t* moves, int loc, int direction);
+
+
+/**************** moves_delete ****************/
+/* Free the tables. */
+void moves_delete(moves_t* moves);
+
+#endif // __MOVES_H
@@ -0,0 +1,112 @@
+/*
+ * rng.c - implementation file for rng module
+ *
+ * xoshiro256** seeded by splitmix64, with Lemire's bounded sampling.
+ * See rng.h for more information.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "rng.h"
+
+/**************** global types ****************/
+typedef struct rng {
+    uint64_t s[4];      // xoshiro256** state, never all zero
+} rng_t;
+
+/**************** local functions ****************/
+static uint64_t rotl(uint64_t x, int k);
+static uint64_t splitmix64(uint64_t* x);
+
+
+/**************** rng_new ****************/
+/* Return a generator seeded with seed.
+ * See rng.h for more information. */
+rng_t* rng_new(uint64_t seed)
+{
+    rng_t* rng = malloc(sizeof(rng_t));
+    if (rng == NULL){
+        fprintf(stderr, "Error: issue allocating memory in rng_new\n");
+        return NULL;
+    }
+    // splitmix64 never gives four zeros in a row
+    for (int i = 0; i < 4; i++){
+        rng->s[i] = splitmix64(&seed);
+    }
+    return rng;
+}
+
+
+/**************** rng_next ****************/
+/* Return the next 64 random bits.
+ * See rng.h for more information. */
+uint64_t rng_next(rng_t* rng)
+{
+    if (rng == NULL){
+        return 0;
+    }
+    uint64_t* s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+
+/**************** rng_below ****************/
+/* Return a number in [0, bound), every one equally likely.
+ * See rng.h for more information. */
+uint32_t rng_below(rng_t* rng, uint32_t bound)
+{
+    if (rng == NULL || bound == 0){
+        return 0;
+    }
+    // the top bits of xoshiro256** are its best
+    uint64_t m = (rng_next(rng) >> 32) * bound;
+    uint32_t low = (uint32_t)m;
+    if (low < bound){
+        // 2^32 mod bound of the low halves would be over-represented
+        uint32_t threshold = -bound % bound;
+        while (low < threshold){
+            m = (rng_next(rng) >> 32) * bound;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+
+/**************** rng_delete ****************/
+/* Free the generator.
+ * See rng.h for more information. */
+void rng_delete(rng_t* rng)
+{
+    free(rng);
+}
+
+
+/**************** rotl ****************/
+static uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+
+/**************** splitmix64 ****************/
+/* Advance *x and return the next splitmix64 output. */
+static uint64_t splitmix64(uint64_t* x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
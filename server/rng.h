@@ -0,0 +1,57 @@
+/*
+ * rng.h - header file for rng module
+ *
+ * A small random number generator (xoshiro256**) whose whole state lives
+ * in one object, so each game draws from its own stream: the same seed
+ * gives the same gold, the same spawns and so the same game, whatever
+ * else is running in the process.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#ifndef __RNG_H
+#define __RNG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+/**************** global types ****************/
+typedef struct rng rng_t;
+
+
+/**************** functions ****************/
+
+/**************** rng_new ****************/
+/* Return a generator seeded with seed.
+ *
+ * Notes:
+ *   any seed is fine, 0 included; the four words of state are filled in
+ *     from it with splitmix64, so nearby seeds give unrelated streams
+ *   returns NULL on any error
+ *   caller is responsible for calling rng_delete
+ */
+rng_t* rng_new(uint64_t seed);
+
+
+/**************** rng_next ****************/
+/* Return the next 64 random bits. */
+uint64_t rng_next(rng_t* rng);
+
+
+/**************** rng_below ****************/
+/* Return a number in [0, bound), every one equally likely (unlike
+ * rand() % bound). Return 0 if bound is 0 or rng is NULL.
+ *
+ * multiply 32 random bits by bound; the high half is the result
+ * reject the few low halves that would make some results more likely
+ */
+uint32_t rng_below(rng_t* rng, uint32_t bound);
+
+
+/**************** rng_delete ****************/
+/* Free the generator. */
+void rng_delete(rng_t* rng);
+
+#endif // __RNG_H
@@ -7,147 +7,142 @@
  * Purpose: Make server work
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 #include "../support/log.h"
 #include "grid.h"
+#include "game.h"
+#include "visibility.h"
+#include "vistune.h"
 #include "../support/message.h"
-#include "../libcs50/set.h"
-#include <math.h>
 
 /****************** Global Constants *******************/
-static const int MAX_PLAYERS = 26;        // max players in game
-static const int GOLD_TOTAL = 250;        // amount of gold game has
-static const int GOLD_MIN_NUM_PILES = 10; // minmimum gold piles
-static const int GOLD_MAX_NUM_PILES = 30; // maximum gold piles
-
-/***************** Player Struct *******************/
-typedef struct player
-{
-  bool isActive;
-  char *name;
-  char playerChar;
-  int gold;
-  int location;
-  grid_t *visibleMap;
-  grid_t *placesSeen;
-  addr_t address;
-} player_t;
-
-
-// Calls in order: 1) addDeleteCurrentPlayer, 2) find new player location (newSprintedLocation), 3) 1 line to update Player, 4) updateGold, 5) changeVisibleMaps, 6) sendVisibility
-void handleMessageContent(grid_t *entireMap, int *walls, hashtable_t *goldRemaining, hashtable_t *playerLocations, char move, const char *from, addr_t clientAddress);
-
-// Return updated playerLocations
-// Checks for 'Q' and adds/removes players (DOES NOT MOVE PLAYER)
-void addDeleteCurrentPlayer(hashtable_t *playerLocations, addr_t playerAddress);
-
-// Return updated goldRemaining
-void updateGold(hashtable_t *goldRemaining, hashtable_t *playerLocations, addr_t playerADDRAddress, const char *playerCharAddress, int newPlayerLoc);
-
-// Changes player visibleMap and returns the changed value
-// Calls in order: 1) twoSidedHash, 2) spaceBetween
-void updateVisibility(grid_t *entireMap, player_t *player, int *walls, hashtable_t *goldRemaining, int oldLoc);
+#define ADDRESS_INDEX_SIZE 64              // slots in the address index, a power of two over 2 * GAME_MAX_PLAYERS
+#define MAX_SPECTATORS 16                  // watching at once; one more replaces the one watching longest
+static const int VIS_CACHE_SLOTS = 4096;  // visibility cache size for the cache strategy
+static const double VIS_TUNE_BUDGET = 0.5; // seconds to spend picking a visibility strategy
+static const int VIS_RADIUS = 5;          // default visibility radius (--radius)
+static const int FRAME_THREADS = 0;       // default frame-drawing threads (--frame-threads): the shipped maps are too small to use any
+static const double IDLE_WAIT = 3600;     // seconds to wait for messages when no frame is held
+
+/***************** Server Options Struct *******************/
+// Optional --flags given after the map file (and seed)
+typedef struct serverOptions
+{
+  bool autoTune;            // no --visibility: benchmark strategies at startup
+  visStrategy_t strategy;   // --visibility NAME (--precompute is cache, --vistable is table)
+  int radius;      // --radius N: how far players can see
+  double tickRate; // --tick HZ: apply queued keys HZ times a second (0 = as they arrive)
+  double pace;     // --pace MS: at least this many milliseconds between a client's frames (0 = no pacing)
+  int paceBurst;   // --pace-burst N: frames a client may be sent back to back before pacing holds them
+  int frameThreads; // --frame-threads N: threads drawing whole frames (0 = the server's own)
+} serverOptions_t;
+
+/***************** Pacer Struct *******************/
+// Frame pacing in immediate mode: a token bucket per client. A frame sent
+// spends a token, and tokens come back one per interval, up to burst. A
+// client with no token is held (game_hold): their frame keeps changing
+// and only the latest goes out once they have a token again, at the
+// absolute time the token is due, which bounds the message loop's wait. The
+// spectators share one bucket, at index GAME_MAX_PLAYERS, as they share one feed.
+typedef struct pacer
+{
+  double interval;                          // seconds per token, 0 if there is no pacing
+  int burst;
+  double tokens[GAME_MAX_PLAYERS + 1];
+  double refilled[GAME_MAX_PLAYERS + 1];    // when tokens were last topped up
+  bool sent[GAME_MAX_PLAYERS + 1];          // sent a frame in the flush going on
+  double release[GAME_MAX_PLAYERS + 1];     // if held, when their next token is due (else 0)
+} pacer_t;
+
+/***************** Client Table Struct *******************/
+// Who is at the other end of each player slot of the game, and who is spectating.
+// index is an open-addressed hash of client addresses (ip and port) to
+// slot + 1 (0 is empty), so finding who sent a message is a few compares.
+// The game draws one spectator view; every spectator is sent the same
+// message in one batch, so another spectator costs one more datagram.
+typedef struct clientTable
+{
+  addr_t address[GAME_MAX_PLAYERS];   // by player slot
+  uint8_t index[ADDRESS_INDEX_SIZE];
+  addr_t spectators[MAX_SPECTATORS];  // oldest first; the last one is the newest
+  int numSpectators;
+  pacer_t pacer;
+} clientTable_t;
+
+/***************** Message Args Struct *******************/
+// Everything the message_loop handlers need
+typedef struct messageArgs
+{
+  game_t *game;
+  clientTable_t *clients;
+  double interval;  // seconds per tick, 0 in immediate mode
+  double next;      // when the next tick is due
+  int minScale;     // the smallest spectator overview scale that fits in a datagram
+  int mapRows;      // the map's size, which bounds a viewport
+  int mapCols;
+} messageArgs_t;
 
-// Changes all the players visibleMaps
-// Calls hashtable_iterate using 1) iteratePlayerHashtable, and 2) iterateGoldHashtable
-void changeAllVisibleMaps(grid_t *entireMap, hashtable_t *goldRemaining, hashtable_t *playerLocations, player_t *curPlayer, int oldLoc, int newLoc);
-
-// Iterates through all the players and updates their visible maps
-void iteratePlayerHashtable(void *entireMap, const char *address, void *player);
-
-// Iterate through all the goldRemaining and update entireMap accordingly
-void iterateGoldHashtable(void *entireMap, const char *goldLoc, void *goldAmount);
-
-// Iterates through every sprinted through location
-// Calls in order: 1) update the player, 2) updateGold, 3) updateVisibility (includes updating spectator), 4) sendVisibility
-int newSprintedLocation(grid_t *entireMap, player_t *curPlayer, char move, const char *playerCharAddress, hashtable_t *goldRemaining, hashtable_t *playerLocations, int *walls, int currentPlayerLocation, addr_t spectator);
-
-// Returns true if the character is in a cooridor
-bool twoSidedHash(int curPlayerLoc, grid_t *entireMap);
-
-// Returns all the points between the wall and the (new) player location
-// IFF there are no " " or "|" between the wall and the (new) player location
-set_t *spaceBetween(int curWall, int curPlayerLoc, grid_t *entireMap);
 
 // Checks if all inputs are valid
-static void parseArgs(int argc, char *argv[], char **mapFile, FILE **fileAddress, int *seed);
-
-// loops in message_loop to deal with input on socket
-bool handleMessage(void *arg, const addr_t from, const char *message);
+static void parseArgs(int argc, char *argv[], char **mapFile, FILE **fileAddress, int *seed, serverOptions_t *options);
 
-// attempts to add a new player to playerLocations
-// returns true or false based on success
-bool addNewPlayer(hashtable_t *playerLocations, const char *username, const char *addr, grid_t *entireMap, addr_t givenAddress);
+// the game's sink: sends a message to the client playing a slot, or to the spectator
+void sendToClient(void *arg, int player, gameMessage_t type, const char *message);
 
-// attemps to add new spectator or change existing spectator
-// returns true of false based on success
-bool addNewSpectator(const addr_t oldAddress, const addr_t newAddress);
-
-// helper function that counts keys in hashtable_t
-void count_keys(void *arg, const char *key, void *item);
-
-// function that counts items in hashtable based on their key existing
-int hashtable_key_count(hashtable_t *ht);
-
-// generate a message for game over
-char *generateQuitMessage(hashtable_t *playerLocations);
-
-// helper function to add player stats to game over message
-void formatPlayerInfo(void *arg, const char *key, void *value);
-
-// function to send game over to all players
-void broadCastQuitMessage(hashtable_t *playerLocations, char *message);
-
-// helper function that sends individual players a game over message
-void sendPlayerQuitMessage(void *arg, const char *key, void *value);
+// loops in message_loop to deal with input on socket; in tick mode, also runs the tick if it is due
+bool handleMessage(void *arg, const addr_t from, const char *message);
 
-// helper function that adds gold in hashtable to a total
-void sumGold(void *arg, const char *key, void *value);
+// acts on one message from a client; returns true if the game is over
+bool handleRequest(messageArgs_t *args, const addr_t from, const char *message);
 
-// function to check if there is gold left
-bool isGoldEmpty(hashtable_t *goldMap);
+// called by message_loopUntil when the next tick, or a held client's next token, is due
+bool handleTimeout(void *arg);
 
-// function to loop through players and prtin their visible maps
-void printAllVisibleMaps(hashtable_t *playerLocations);
+// seconds until the next tick is due, or with pacing the first held client's
+// token (message_loopUntil waits no longer)
+double timeLeft(void *arg);
 
-// helper function that sends a player their udpated visible map
-void send_display_map(void *arg, const char *key, void *item);
+// in tick mode, runs the tick if it is due; returns true if the game is over
+bool tickIfDue(messageArgs_t *args);
 
-// sends the spectator the entireMap
-void printSpectatorMap(addr_t spectatorAddr, hashtable_t *playerLocations,
-                       grid_t *entireMap);
+// in immediate mode, sends the frames due, holding back those of clients sent one too recently
+void flushPaced(messageArgs_t *args);
 
-// helper function that adds players to entireMap
-void addPlayersToMap(void *arg, const char *key, void *item);
+// seconds on a monotonic clock
+double now(void);
 
-// helper function to free memory for goldRemaining
-void freeGoldEntry(void *item);
+// attempts to add a new player to the game (or bring back one who quit)
+// returns their slot, or -1 if the game is full
+int addNewPlayer(messageArgs_t *args, const char *username, addr_t givenAddress);
 
-// helper function to free memory for playerLocations
-void freePlayerEntry(void *item);
+// adds a spectator at the end of the list, replacing the oldest if it is full
+// (someone already watching just moves to the end); returns true on success
+bool addNewSpectator(clientTable_t *clients, const addr_t newAddress);
 
-// sends a message to every client about a change in gold value
-void goldUpdateMessage(hashtable_t *playerLocations, hashtable_t *goldRemaining,
-                       addr_t pickedUpAddr, int goldAmount);
+// returns the smallest overview scale whose frames fit in one datagram (1 if the whole map does)
+int overviewScale(int rows, int cols);
 
-// helper function to sum all gold in map
-void sumRemainingGold(void *arg, const char *key, void *value);
+// returns true if a window of rows lines of cols chars, with its header, fits in one datagram
+bool windowFits(int rows, int cols);
 
-// helper function to send an update message to every client about gold value change and or pickup
-void sendGoldUpdate(void *arg, const char *key, void *value);
+// returns where address is in the spectator list, or -1 if it is not
+int findSpectator(clientTable_t *clients, addr_t address);
 
-// Updates a diagonal - called in updateVisibility for set iterate
-void updateDiagonal(void *arg, const char *key, void *item);
+// takes the spectator at position i off the list, keeping the rest in order
+void removeSpectator(clientTable_t *clients, int i);
 
-// if moved player is visible, then make them visible
-void iterateMovedPlayer(void *movedPlayer, const char *address, void *curPlayer);
+// returns the slot of the player at this address, or -1 if there is none
+int findPlayer(clientTable_t *clients, addr_t address);
 
-// swap players if one moves into another
-void swapPlayerLocation(void* data, const char* key, void* item);
+// returns where address belongs in the address index: its entry, or the empty one to put it in
+int addressIndexSlot(clientTable_t *clients, addr_t address);
 
 
 /**************** main function *************************/
@@ -156,19 +151,10 @@ int main(int argc, char *argv[])
   FILE *fileAddress = NULL;
   char *mapFile = NULL;
   int seed = 0;
-
-  // define struct locally
-  typedef struct messageArgs
-  {
-    grid_t *entireMap;
-    int *walls;
-    hashtable_t *goldRemaining;
-    hashtable_t *playerLocations;
-    addr_t spectator;
-  } messageArgs_t;
+  serverOptions_t options = {true, VIS_STRATEGY_REGION, VIS_RADIUS, 0, 0, 1, FRAME_THREADS};
 
   // validate the arguments given in command line
-  parseArgs(argc, argv, &mapFile, &fileAddress, &seed);
+  parseArgs(argc, argv, &mapFile, &fileAddress, &seed, &options);
 
   // create our full grid
   grid_t *grid = grid_fromFile(fileAddress);
@@ -178,205 +164,275 @@ int main(int argc, char *argv[])
     exit(3);
   }
 
-  hashtable_t *goldRemaining = grid_makeGold(grid, GOLD_MIN_NUM_PILES,
-                                             GOLD_MAX_NUM_PILES, GOLD_TOTAL);
-  if (goldRemaining == NULL)
+  // nobody is connected yet
+  clientTable_t clients;
+  memset(&clients, 0, sizeof(clients));
+
+  // the game itself: gold, players and views; it owns the grid from here on
+  game_t *game = game_new(grid, (uint64_t)seed, options.radius, sendToClient, &clients);
+  if (game == NULL)
   {
-    fprintf(stderr, "Error: could not generate gold in map\n");
-    grid_delete(grid);
+    fprintf(stderr, "Error: could not set up the game\n");
     exit(4);
   }
 
-  // Make empty player's hashtable
-  hashtable_t *playerLocations = hashtable_new(MAX_PLAYERS);
-  if (playerLocations == NULL)
+  // whole frames are drawn on their own threads only if asked: frame_drawAll
+  // only splits redraws of tens of thousands of cells
+  if (options.frameThreads > 0 && !game_frameThreads(game, options.frameThreads))
   {
-    fprintf(stderr, "Error: could not create player location hashtable.\n");
-    grid_delete(grid);
-    hashtable_delete(goldRemaining, freeGoldEntry);
-    exit(5);
+    fprintf(stderr, "frames: could not start %d drawing threads, drawing on the server's\n", options.frameThreads);
   }
 
   // begin server logging
   log_init(stderr);
 
+  // a map too big for one datagram is shown to spectators as an overview
+  int scale = overviewScale(grid_getHeight(grid), grid_getWidth(grid));
+  if (scale > 1 && game_spectatorOverview(game, scale))
+  {
+    fprintf(stderr, "spectators: map too big for one message, sending a 1:%d overview\n", scale);
+  }
+
   // begins running server (message_init should print port)
   int serverPort = message_init(stderr);
   if (serverPort == 0)
   {
     log_e("failed to intialize server.\n");
-    grid_delete(grid);
-    hashtable_delete(goldRemaining, freeGoldEntry);
-    hashtable_delete(playerLocations, freePlayerEntry);
+    game_delete(game);
     log_done();
     exit(6);
   }
 
   log_d("Server running on port %d", serverPort);
 
-  // create a struct for the extra args in message_loop
-  messageArgs_t args;
-
-  int *walls = grid_getWalls(grid);
-  if (walls == NULL)
+  // pick how visibility is computed: the fastest on this map, or as told
+  visibility_t *vis = game_visibility(game);
+  if (options.autoTune)
   {
-    fprintf(stderr, "Failed to gather grid walls.\n");
-    grid_delete(grid);
-    hashtable_delete(goldRemaining, freeGoldEntry);
-    hashtable_delete(playerLocations, freePlayerEntry);
-    log_done();
-    message_done();
-    exit(8);
+    vistune_choose(vis, VIS_CACHE_SLOTS, VIS_TUNE_BUDGET, stderr);
+  }
+  else if (visibility_setStrategy(vis, options.strategy, VIS_CACHE_SLOTS))
+  {
+    fprintf(stderr, "visibility: using %s (forced)\n", visibility_strategyName(options.strategy));
+  }
+  else
+  {
+    log_s("could not set up visibility strategy %s, using region", visibility_strategyName(options.strategy));
   }
+  visibility_reportTable(vis, stderr);
 
   // add in values for args
-  args.entireMap = grid;
-  args.playerLocations = playerLocations;
-  args.goldRemaining = goldRemaining;
-  args.walls = walls;
-  args.spectator = message_noAddr();
+  messageArgs_t args;
+  args.game = game;
+  args.clients = &clients;
+  args.interval = 0;
+  args.next = 0;
+  args.minScale = scale;
+  args.mapRows = grid_getHeight(grid);
+  args.mapCols = grid_getWidth(grid);
 
   // continual loop of server running
-  message_loop(&args, 0, NULL, NULL, handleMessage);
-  // should terminate by returning false after detecting no gold remaining
-
-  // creates a message for quitting with final score
-  char *message = generateQuitMessage(playerLocations);
-  if (message == NULL)
+  if (options.tickRate > 0)
   {
-    fprintf(stderr, "Failed to make final message.\n");
-    grid_delete(grid);
-    free(args.walls);
-    hashtable_delete(goldRemaining, freeGoldEntry);
-    hashtable_delete(playerLocations, freePlayerEntry);
-    log_done();
-    message_done();
-    exit(9);
+    // nothing queued, first tick one interval from now
+    args.interval = 1.0 / options.tickRate;
+    args.next = now() + args.interval;
+    log_d("Tick mode: %g ticks per second", options.tickRate);
+    message_loopUntil(&args, timeLeft, handleTimeout, NULL, handleMessage);
+  }
+  else if (options.pace > 0)
+  {
+    // every client starts with a full bucket; held frames go out when their token is due
+    pacer_t *pacer = &clients.pacer;
+    pacer->interval = options.pace / 1000;
+    pacer->burst = options.paceBurst;
+    for (int i = 0; i <= GAME_MAX_PLAYERS; i++)
+    {
+      pacer->tokens[i] = pacer->burst;
+      pacer->refilled[i] = now();
+      pacer->release[i] = 0;
+    }
+    fprintf(stderr, "pacing: frames at least %g ms apart, %d back to back\n", options.pace, options.paceBurst);
+    message_loopUntil(&args, timeLeft, handleTimeout, NULL, handleMessage);
+  }
+  else
+  {
+    message_loop(&args, 0, NULL, NULL, handleMessage);
   }
+  // should terminate by returning false after detecting no gold remaining
 
-  // iterates over players and sends quit message
-  broadCastQuitMessage(playerLocations, message);
-  message_send(args.spectator, message);
-  free(message);
+  // sends everyone the final scores
+  game_end(game);
 
   // cleanup
+  visibility_report(vis, stderr);
+  game_report(game, stderr);
   message_done();
   log_done();
-  grid_delete(grid);
-  hashtable_delete(goldRemaining, freeGoldEntry);
-  hashtable_delete(playerLocations, freePlayerEntry);
-  free(walls);
+  game_delete(game);
 
   exit(0);
 }
 
-// helper function to free allocated mmeory for goldRemaining hashtable
-void freeGoldEntry(void *item)
-{
-  free((int *)item); // free int*
-}
-
-// helper function to free allocated memory for playerLocations hashtable
-void freePlayerEntry(void *item)
-{
-  // cast player to right type
-  player_t *player = (player_t *)item;
-
-  // delete malloc'd grids
-  grid_delete(player->visibleMap);
-  grid_delete(player->placesSeen);
-  free(player->name);
-  free(player); // free
-}
-
 // validates arguments and assigns them to variables if they are valid
-static void parseArgs(int argc, char *argv[], char **mapFile, FILE **fileAddress, int *seed)
+static void parseArgs(int argc, char *argv[], char **mapFile, FILE **fileAddress, int *seed, serverOptions_t *options)
 {
-  // assign given file to mapFile address
-  *mapFile = argv[1];
-
-  // if a 2nd argument is given, read as seed for random number generator
-  if (argc == 3)
+  // pull out --flags, leaving the map file and optional seed in order
+  char *positional[2];
+  int nPositional = 0;
+  for (int i = 1; i < argc; i++)
   {
-    // casts the written seed to an int (NEEDS ERROR CHECK)
-    *seed = (int)strtol(argv[2], NULL, 10);
-
-    // tries to validate mapFile by opening in read mode
-    FILE *fp = fopen(*mapFile, "r");
-    if (fp == NULL)
+    if (strcmp(argv[i], "--precompute") == 0)
     {
-      fprintf(stderr, "Error: cannot open map file '%s'\n", *mapFile);
-      exit(2);
+      options->autoTune = false;
+      options->strategy = VIS_STRATEGY_CACHE;
     }
-    *fileAddress = fp;
-  }
-  else if (argc == 2)
-  {
-    // turns seed into the int version of time
-    *seed = (int)time(NULL);
-
-    // tries to validate mapFile by opening in read mode
-    FILE *fp = fopen(*mapFile, "r");
-    if (fp == NULL)
+    else if (strcmp(argv[i], "--vistable") == 0)
+    {
+      options->autoTune = false;
+      options->strategy = VIS_STRATEGY_TABLE;
+    }
+    else if (strcmp(argv[i], "--visibility") == 0 && i + 1 < argc)
+    {
+      options->autoTune = strcmp(argv[++i], "auto") == 0;
+      if (!options->autoTune && !visibility_parseStrategy(argv[i], &options->strategy))
+      {
+        nPositional = 0; // no such strategy
+        break;
+      }
+    }
+    else if (strcmp(argv[i], "--radius") == 0 && i + 1 < argc)
+    {
+      char *end;
+      options->radius = (int)strtol(argv[++i], &end, 10);
+      if (*end != '\0' || options->radius < 1)
+      {
+        nPositional = 0; // not a positive number
+        break;
+      }
+    }
+    else if (strcmp(argv[i], "--tick") == 0 && i + 1 < argc)
+    {
+      char *end;
+      options->tickRate = strtod(argv[++i], &end);
+      if (*end != '\0' || !(options->tickRate > 0))
+      {
+        nPositional = 0; // not a positive rate
+        break;
+      }
+    }
+    else if (strcmp(argv[i], "--pace") == 0 && i + 1 < argc)
+    {
+      char *end;
+      options->pace = strtod(argv[++i], &end);
+      if (*end != '\0' || !(options->pace > 0))
+      {
+        nPositional = 0; // not a positive interval
+        break;
+      }
+    }
+    else if (strcmp(argv[i], "--pace-burst") == 0 && i + 1 < argc)
+    {
+      char *end;
+      options->paceBurst = (int)strtol(argv[++i], &end, 10);
+      if (*end != '\0' || options->paceBurst < 1)
+      {
+        nPositional = 0; // not a positive count
+        break;
+      }
+    }
+    else if (strcmp(argv[i], "--frame-threads") == 0 && i + 1 < argc)
+    {
+      char *end;
+      options->frameThreads = (int)strtol(argv[++i], &end, 10);
+      if (*end != '\0' || options->frameThreads < 0)
+      {
+        nPositional = 0; // not a count
+        break;
+      }
+    }
+    else if (strncmp(argv[i], "--", 2) == 0 || nPositional == 2)
     {
-      fprintf(stderr, "Error: cannot open map file '%s'\n", *mapFile);
-      exit(2);
+      nPositional = 0; // unknown flag or too many arguments
+      break;
+    }
+    else
+    {
+      positional[nPositional++] = argv[i];
     }
-    *fileAddress = fp;
   }
-  else
+
+  // ticks already send each client one frame a tick, so pacing is for immediate mode
+  if (options->tickRate > 0 && options->pace > 0)
   {
-    fprintf(stderr, "Usage: %s mapFile [optional] seed\n", argv[0]);
-    exit(1);
+    nPositional = 0;
   }
 
-  // this should seed random number generation across this whole program
-  srand(*seed);
-}
-
-// creates a quit message that caller must free
-char* generateQuitMessage(hashtable_t *playerLocations)
-{
-  char *message = malloc(2048);
-  if (!message)
+  if (nPositional == 0)
   {
-    return NULL;
+    fprintf(stderr, "Usage: %s mapFile [optional] seed [--radius N] [--visibility auto|ray|region|table|cache] [--tick HZ | --pace MS [--pace-burst N]] [--frame-threads N]\n", argv[0]);
+    exit(1);
   }
 
-  strcpy(message, "QUIT GAME OVER:\n");                          // start with a header
-  hashtable_iterate(playerLocations, message, formatPlayerInfo); // add players
-
-  return message; // must be freed
-}
+  // assign given file to mapFile address
+  *mapFile = positional[0];
 
-void formatPlayerInfo(void *arg, const char *key, void *value)
-{
-  char* message = (char *)arg;
-  player_t* player = (player_t *)value;
+  // if a 2nd argument is given, read as seed for random number generator
+  if (nPositional == 2)
+  {
+    // casts the written seed to an int (NEEDS ERROR CHECK)
+    *seed = (int)strtol(positional[1], NULL, 10);
+  }
+  else
+  {
+    // turns seed into the int version of time
+    *seed = (int)time(NULL);
+  }
 
-  if (player != NULL)
+  // tries to validate mapFile by opening in read mode
+  FILE *fp = fopen(*mapFile, "r");
+  if (fp == NULL)
   {
-    char line[100]; // temporary buffer for line
-    snprintf(line, sizeof(line), "%c %10d %s\n", player->playerChar, player->gold, player->name);
-    strcat(message, line); // add line to message
+    fprintf(stderr, "Error: cannot open map file '%s'\n", *mapFile);
+    exit(2);
   }
+  *fileAddress = fp;
 }
 
-// broadcast quit message to all players
-void broadCastQuitMessage(hashtable_t *playerLocations, char *message)
-{
-  hashtable_iterate(playerLocations, message, sendPlayerQuitMessage);
-}
 
-// retrieves player address and sends them the quit message
-void sendPlayerQuitMessage(void *arg, const char *key, void *value)
+// hands a message from the game to whoever plays that slot, or to the spectators
+void sendToClient(void *arg, int player, gameMessage_t type, const char *message)
 {
-  char *message = (char *)arg;
-  player_t *player = (player_t *)value;
+  clientTable_t *clients = arg;
 
-  if (player != NULL)
+  // a frame spends one of the client's pacing tokens, after the flush
+  if (type == GAME_MSG_FRAME)
   {
-    message_send(player->address, message);
+    if (player == GAME_SPECTATOR)
+    {
+      clients->pacer.sent[GAME_MAX_PLAYERS] = true;
+    }
+    else if (player >= 0)
+    {
+      clients->pacer.sent[player] = true;
+    }
+  }
+
+  if (player == GAME_SPECTATOR)
+  {
+    // one message for all of them, in one batch
+    message_sendMany(clients->spectators, clients->numSpectators, message);
+  }
+  else if (player == GAME_NEW_SPECTATOR)
+  {
+    if (clients->numSpectators > 0)
+    {
+      message_send(clients->spectators[clients->numSpectators - 1], message);
+    }
+  }
+  else
+  {
+    message_send(clients->address[player], message);
   }
 }
 
@@ -385,58 +441,50 @@ void sendPlayerQuitMessage(void *arg, const char *key, void *value)
 bool handleMessage(void *arg, const addr_t from, const char *message)
 {
 
-  // we use this to index into our hashtable
-  const char *fromString = message_stringAddr(from);
-
-  // local struct for args pashed to this function
-  struct
-  {
-    grid_t *entireMap;
-    int *walls;
-    hashtable_t *goldRemaining;
-    hashtable_t *playerLocations;
-    addr_t spectator;
-  } *args = arg;
+  // args passed to message_loop
+  messageArgs_t *args = arg;
 
   // convert to proper pointer and check
   if (args == NULL)
   {
     log_e("Failed to convert args from (void*)");
+    return false;
+  }
+
+  bool over = handleRequest(args, from, message);
+
+  // a steady stream of messages must not hold up the tick, whatever the message was
+  if (!over && args->interval > 0)
+  {
+    over = tickIfDue(args);
   }
+  return over;
+}
+
+bool handleRequest(messageArgs_t *args, const addr_t from, const char *message)
+{
 
-  if (isGoldEmpty(args->goldRemaining))
+  if (game_over(args->game))
   {
     return true;
   }
 
+  clientTable_t *clients = args->clients;
+
   if (strncmp(message, "PLAY ", strlen("PLAY ")) == 0)
   {
     const char *content = message + strlen("PLAY ");
 
-    // Attempt to add new player
-    if (addNewPlayer(args->playerLocations, content, fromString, args->entireMap, from))
+    // Attempt to add new player; the game sends them OK and GRID
+    int newSlot = addNewPlayer(args, content, from);
+    if (newSlot >= 0)
     {
-
-      // sends player confirmation of joining with their char
-      player_t *newPlayer = hashtable_find(args->playerLocations, fromString);
-      char joinMessage[] = "OK X";
-      joinMessage[3] = newPlayer->playerChar;
-      message_send(from, joinMessage);
-
-      // sends player grid on join
-      int width = grid_getWidth(args->entireMap);
-      int height = grid_getHeight(args->entireMap);
-      char gridMessage[32];
-      snprintf(gridMessage, sizeof(gridMessage), "GRID %d %d", height, width);
-      message_send(from, gridMessage);
-
-      // Attemping to create an intial print of display message
-      updateVisibility(args->entireMap, newPlayer, args->walls, args->goldRemaining, newPlayer->location);
-
-      // finally, send them their current visible map
-      printAllVisibleMaps(args->playerLocations);
-      printSpectatorMap(args->spectator, args->playerLocations, args->entireMap);
-
+      // finally, send them their current visible map (with the next tick, in tick mode)
+      if (args->interval > 0)
+      {
+        return false;
+      }
+      flushPaced(args);
       return false;
     }
     else
@@ -450,21 +498,11 @@ bool handleMessage(void *arg, const addr_t from, const char *message)
   else if (strncmp(message, "SPECTATE", strlen("SPECTATE")) == 0)
   {
 
-    // assign a new spectator after checking to kick the old one
-    if (addNewSpectator(args->spectator, from))
+    // add them to the spectators, kicking the oldest if there are too many
+    if (addNewSpectator(clients, from))
     {
-      args->spectator = from;
-
-      // sends player grid on join
-      int width = grid_getWidth(args->entireMap);
-      int height = grid_getHeight(args->entireMap);
-      char gridMessage[32];
-      snprintf(gridMessage, sizeof(gridMessage), "GRID %d %d", height, width);
-      message_send(from, gridMessage);
-
-      // gives spectator their first map
-      printSpectatorMap(from, args->playerLocations, args->entireMap);
-
+      // the game sends them the grid and their first map
+      game_spectate(args->game, true);
       return false;
     }
     else
@@ -491,1014 +529,336 @@ bool handleMessage(void *arg, const addr_t from, const char *message)
       return false;
     }
 
-    // delete the player from hashtable
-    // Q Press
-
-    player_t *p = hashtable_find(args->playerLocations, fromString);
-
-    // if we have a non spectator inactive player ignore
-    // if spectator is rejoined inactive player then continue
-    if (p != NULL && p->isActive == false && !message_eqAddr(args->spectator, from))
-    {
-      return false; // ignore becuase this player is inactive (should only happen in testing)
-    }
+    int slot = findPlayer(clients, from);
 
-    if (messageChar == 'Q' || messageChar == 'q')
+    // a player who quit is ignored, unless they came back as a spectator
+    if (slot < 0 || !game_isActive(args->game, slot))
     {
-      // check that this is a player (not a spectator)
-
-      if (p != NULL)
+      int spectator = findSpectator(clients, from);
+      if (spectator >= 0 && (messageChar == 'Q' || messageChar == 'q'))
       {
-        // if it's a real player
-        p->isActive = false;
-        char *quitMessage = "QUIT Thanks for playing!";
-        message_send(from, quitMessage);
-      }
-      else if (message_eqAddr(args->spectator, from))
-      {
-        // it's the spectator
+        // it's a spectator
         char *spectatorQuitMessage = "QUIT Thanks for spectating!";
         message_send(from, spectatorQuitMessage);
-        args->spectator = message_noAddr();
-      }
-      else
-      {
-        log_e("Unexpected address for quit message");
+        removeSpectator(clients, spectator);
+        if (clients->numSpectators == 0)
+        {
+          game_spectate(args->game, false);
+        }
       }
+      // ignore all other spectator key presses, and strangers
       return false;
     }
 
-    // ignore all other spectator key presses
-    if (message_eqAddr(args->spectator, from)) {
-      return false;
-    }
-
-    const char *fromString = message_stringAddr(from);
-    if (p == NULL)
+    // in tick mode the key waits for the next tick (Q still quits at once)
+    if (args->interval > 0)
     {
-      // not a known player so just ignore
+      if (!game_queue(args->game, slot, messageChar))
+      {
+        log_s("Dropped '%s', too many keys queued this tick", message);
+      }
       return false;
     }
 
-    // process message content for single char of movement (guarenteed not Q)
-    handleMessageContent(args->entireMap, args->walls,
-                         args->goldRemaining, args->playerLocations,
-                         messageChar, fromString, args->spectator);
-    return false;
-  }
-  else
-  {
-    log_s("Recieved an unexpected message '%s'", message);
-    return false;
-  }
-}
-
-// Callback function to sum all gold amounts
-void sumGold(void *arg, const char *key, void *value)
-{
-  int *goldAmount = (int *)value;
-  int *totalGoldLeft = (int *)arg;
-
-  if (goldAmount != NULL && *goldAmount != -1)
-  {
-    *totalGoldLeft += *goldAmount;
-  }
-}
-
-// Function to check if all gold has been collected
-bool isGoldEmpty(hashtable_t *goldMap)
-{
-  if (goldMap == NULL)
-  {
-    return true; // No gold exists somehow
+    // otherwise it happens now, and everyone sees it (with any GOLD)
+    bool over = game_step(args->game, slot, messageChar);
+    flushPaced(args);
+    return over;
   }
-
-  int totalGoldLeft = 0;
-  hashtable_iterate(goldMap, &totalGoldLeft, sumGold);
-
-  return (totalGoldLeft == 0);
-}
-
-// check if we can add a player and if we can, add them
-bool addNewPlayer(hashtable_t *playerLocations, const char *username, const char *addr, grid_t *entireMap, addr_t givenAddress)
-{
-  if (playerLocations == NULL)
-  {
-    return false;
-  }
-
-  player_t *existingPlayer = hashtable_find(playerLocations, addr);
-
-  if (existingPlayer != NULL)
+  else if (strncmp(message, "OVERVIEW ", strlen("OVERVIEW ")) == 0 ||
+           strncmp(message, "REGION ", strlen("REGION ")) == 0)
   {
-    // key already in table
-    if (existingPlayer->isActive)
+    // a spectator picks what all the spectators see
+    int scale, top, left, rows, cols;
+    char extra;
+    bool ok = findSpectator(clients, from) >= 0;
+    if (ok && message[0] == 'O')
     {
-      log_s("Tried to reactivate active player at %s", addr);
+      ok = sscanf(message + strlen("OVERVIEW "), "%d %c", &scale, &extra) == 1 &&
+           scale >= args->minScale && game_spectatorOverview(args->game, scale);
     }
-    else
+    else if (ok)
     {
-      // copy name otherwise bad pointer reference
-      size_t len = strlen(username) + 1;
-      char* nameCopy = malloc(len);
-      if (nameCopy == NULL) {
-        return false;
-      }
-      strcpy(nameCopy, username);
-
-      // give player new attributes
-      existingPlayer->name = nameCopy;
-      existingPlayer->isActive = true;
-      existingPlayer->gold = 0;
+      ok = sscanf(message + strlen("REGION "), "%d %d %d %d %c", &top, &left, &rows, &cols, &extra) == 4;
 
-      grid_makeEmpty(existingPlayer->visibleMap);
-      grid_makeEmpty(existingPlayer->placesSeen);
-
-      return true;
+      // cut off at the edges of the map, as the game will, and it must fit in a datagram;
+      // a corner off the map is the game's to refuse (the sizes are the client's,
+      // so they are compared against what is left of the map, never added to)
+      if (ok && top >= 0 && left >= 0 && top < args->mapRows && left < args->mapCols)
+      {
+        int regionRows = (rows < args->mapRows - top) ? rows : args->mapRows - top;
+        int regionCols = (cols < args->mapCols - left) ? cols : args->mapCols - left;
+        if (regionRows > 0 && regionCols > 0 && !windowFits(regionRows, regionCols))
+        {
+          log_s("Region too big for one message '%s'", message);
+          message_send(from, "ERROR region too big for one message");
+          return false;
+        }
+      }
+      ok = ok && game_spectatorRegion(args->game, top, left, rows, cols);
     }
-  }
-
-  // counts players
-  int nPlayer = hashtable_key_count(playerLocations);
-
-  // reutrn false if too many players
-  if (nPlayer >= 26)
-  {
+    if (!ok)
+    {
+      log_s("Invalid spectator view request '%s'", message);
+      return false;
+    }
+    if (args->interval > 0)
+    {
+      return false;
+    }
+    flushPaced(args);
     return false;
   }
-  else
+  else if (strncmp(message, "VIEWPORT ", strlen("VIEWPORT ")) == 0)
   {
-    // create empty player struct
-    player_t *player = malloc(sizeof(player_t));
-    if (player == NULL)
+    // opt in to frames of just the window around the player (0 0 opts out)
+    int rows, cols;
+    char extra;
+    int slot = findPlayer(clients, from);
+    if (sscanf(message + strlen("VIEWPORT "), "%d %d %c", &rows, &cols, &extra) != 2 || slot < 0)
     {
+      log_s("Invalid viewport request '%s'", message);
       return false;
     }
 
-    // duplicate so no bad pointer
-    size_t len = strlen(username) + 1;
-    char* nameCopy = malloc(len);
-    if (nameCopy == NULL) {
+    // a window is never bigger than the map, and one smaller must fit in a datagram
+    // (clamped with comparisons only: the sizes are the client's)
+    int windowRows = rows < args->mapRows ? rows : args->mapRows;
+    int windowCols = cols < args->mapCols ? cols : args->mapCols;
+    if (windowRows > 0 && windowCols > 0 && (windowRows < args->mapRows || windowCols < args->mapCols) &&
+        !windowFits(windowRows, windowCols))
+    {
+      log_s("Viewport too big for one message '%s'", message);
+      message_send(from, "ERROR viewport too big for one message");
       return false;
-      free(player);
     }
-    strcpy(nameCopy, username);
-
-    // fills in player struct attributes
-    player->isActive = true;
-    player->name = nameCopy;
-    player->playerChar = 'A' + nPlayer;
-    player->gold = 0;
-
-    // finds a valid starting location to give player
-    int startingLocation = 0;
-    char locationChar = grid_get(entireMap, startingLocation);
-    size_t length = grid_getLength(entireMap); 
-
-    // guesses random locations until one is empty
-    while (locationChar != '.')
+    if (!game_viewport(args->game, slot, rows, cols))
     {
-      startingLocation = rand() % length;
-
-      locationChar = grid_get(entireMap, startingLocation);
+      log_s("Invalid viewport request '%s'", message);
+      return false;
     }
 
-    player->location = startingLocation;
-
-    // gives player new empty grids for their visible map and places seen
-    grid_t *vMap = grid_new(grid_getMap(entireMap));
-    grid_t *pMap = grid_new(grid_getMap(entireMap));
-    grid_makeEmpty(vMap);
-    grid_makeEmpty(pMap);
-    player->visibleMap = vMap;
-    player->placesSeen = pMap;
-
-    player->address = givenAddress;
-
-    return hashtable_insert(playerLocations, addr, player);
-  }
-}
-
-// add new spectator or change existing spectator
-bool addNewSpectator(const addr_t oldAddress, const addr_t newAddress)
-{
-  if (message_eqAddr(oldAddress, message_noAddr()))
-  {
-    return true;
+    // their next frame is a window, with the next tick in tick mode
+    if (args->interval > 0)
+    {
+      return false;
+    }
+    flushPaced(args);
+    return false;
   }
   else
   {
-    // don't forget to kick old spectator
-    char *kickMessage = "QUIT You have been replaced by a new spectator.";
-    message_send(oldAddress, kickMessage);
-    return true;
-  }
-}
-
-// helper funciton for iteration
-void count_keys(void *arg, const char *key, void *item)
-{
-  if (key != NULL)
-  {
-    (*(int *)arg)++; // iterate count that is in arg
+    log_s("Recieved an unexpected message '%s'", message);
+    return false;
   }
 }
 
-// go through and count items in a hashtable (if key exists)
-int hashtable_key_count(hashtable_t *ht)
+// the wait ends at the deadline, even with messages coming in
+bool handleTimeout(void *arg)
 {
-  if (ht == NULL)
+  messageArgs_t *args = arg;
+  if (args->interval > 0)
   {
-    return 0;
+    return tickIfDue(args);
   }
-
-  int count = 0;
-  hashtable_iterate(ht, &count, count_keys);
-  return count;
+  // let go of the frames whose token is now due
+  flushPaced(args);
+  return false;
 }
 
-// Give a new message I will update gold and visibility for all players
-void handleMessageContent(grid_t *entireMap, int *walls, hashtable_t *goldRemaining, hashtable_t *playerLocations, char move, const char *from, addr_t spectator)
+double timeLeft(void *arg)
 {
-
-  // IF "Q" THEN PRIOR FUNCTION ALREADY TAKE CARE OF THAT
-  // Should only be 1 char (ex. h,j,k,l)
-
-  player_t *curPlayer = hashtable_find(playerLocations, from);
-
-  // Check if curPlayer exists
-  if (curPlayer == NULL)
+  messageArgs_t *args = arg;
+  if (args->interval > 0)
   {
-    log_e("SOMETHING WENT VERY WRONG -- THERE IS NO PLAYER AT ADDRESS\n");
-    return;
+    return args->next - now();
   }
 
-  int oldLoc = curPlayer->location;
-
-  int width = grid_getWidth(entireMap) + 1;
-
-  int newLoc = -1;
-
-  // Based off of:
-  // y k u
-  // h @ l
-  // b j n
-  // q = quit = return -1
-  // anything else return NULL
-  if (move == 'h')
-  {
-    newLoc = oldLoc - 1;
-  }
-  else if (move == 'y')
-  {
-    newLoc = oldLoc - 1 - width;
-  }
-  else if (move == 'k')
+  // the first held client's token; nothing held, nothing to wake up for
+  pacer_t *pacer = &args->clients->pacer;
+  double soonest = 0;
+  for (int i = 0; i <= GAME_MAX_PLAYERS; i++)
   {
-    newLoc = oldLoc - width;
-  }
-  else if (move == 'u')
-  {
-    newLoc = oldLoc + 1 - width;
-  }
-  else if (move == 'l')
-  {
-    newLoc = oldLoc + 1;
-  }
-  else if (move == 'n')
-  {
-    newLoc = oldLoc + 1 + width;
-  }
-  else if (move == 'j')
-  {
-    newLoc = oldLoc + width;
-  }
-  else if (move == 'b')
-  {
-    newLoc = oldLoc - 1 + width;
-  }
-  else if (move == 'H' || move == 'Y' || move == 'K' || move == 'U' || move == 'L' || move == 'N' || move == 'J' || move == 'B')
-  {
-    // Look if caps lock therefore sprinting. Loop through all points with samne code as belwo
-
-    newLoc = newSprintedLocation(entireMap, curPlayer, move, from, goldRemaining, playerLocations, walls, oldLoc, spectator);
-    // Do everything in here because I already check visibility and wall constraints.
-    curPlayer->location = newLoc;
-    return;
-  }
-  else
-  {
-    return;
-  }
-
-  // Check if we're just hitting a wall or out of bounds
-  char newLocChar = grid_get(entireMap, newLoc);
-  if (newLocChar == '|' || newLocChar == '-' || newLocChar == '+' || newLocChar == ' ')
-  {
-    // return oldLoc;
-    log_e("YOU HIT A WALL\n");
-    return;
-  }
-  else if ((newLoc % width == 0 && oldLoc % width == 1) || (newLoc % width == 1 && oldLoc % width == 0))
-  {
-    // Would only happen if cooridors are right on the edge of the screen
-    log_e("YOU TIRED MOVING OFF THE BOARD (sideways)\n");
-    return;
-  }
-  else if ((newLoc < width + 1 && oldLoc > grid_getLength(entireMap) - width) || (newLoc > grid_getLength(entireMap) - width && oldLoc < width + 1))
-  {
-    // Would only happen if cooridors are right on the edge of the screen
-    log_e("YOU TIRED MOVING OFF THE BOARD (up/down)\n");
-    return;
-  }
-
-  // Function names here are intuitive.
-  // Put the newLoc into player to replace the oldLoc
-  curPlayer->location = newLoc;
-  updateGold(goldRemaining, playerLocations, curPlayer->address, from, newLoc);
-
-  updateVisibility(entireMap, curPlayer, walls, goldRemaining, oldLoc);
-
-  // Swapping with player if I landed on them
-  int data[3] = {(int)curPlayer->playerChar, oldLoc, newLoc};
-  hashtable_iterate(playerLocations, data, swapPlayerLocation);
-
-  changeAllVisibleMaps(entireMap, goldRemaining, playerLocations, curPlayer, oldLoc, newLoc);
-
-  printAllVisibleMaps(playerLocations);
-  printSpectatorMap(spectator, playerLocations, entireMap);
-}
-
-void swapPlayerLocation(void* data, const char* key, void* item){
-  // look at all player locations. If they're the same as newLoc then put the playerChar at oldLoc
-  int *intData = (int *)data; // Cast to int*
-  char playerChar = (char) intData[0];
-  int oldLoc = intData[1];
-  int newLoc = intData[2];
-  
-  player_t *player = (player_t *) item;
-  if((playerChar != player->playerChar) && newLoc == player->location){
-    player->location = oldLoc;
+    if (pacer->release[i] > 0 && (soonest == 0 || pacer->release[i] < soonest))
+    {
+      soonest = pacer->release[i];
+    }
   }
+  return soonest > 0 ? soonest - now() : IDLE_WAIT;
 }
 
-// Will work by looping through player hashtable getting their visible maps then sending them to all addresses
-void printAllVisibleMaps(hashtable_t *playerLocations)
+bool tickIfDue(messageArgs_t *args)
 {
-  if (playerLocations == NULL)
+  double time = now();
+  if (time < args->next)
   {
-    return;
-  }
-
-  hashtable_iterate(playerLocations, NULL, send_display_map);
-}
-
-void send_display_map(void *arg, const char *key, void *item)
-{
-  if (item == NULL) return; // check for NULL pointer
-
-  // check that nothing is NULL
-  player_t *player = (player_t *)item;
-  if (player == NULL) return;
-  grid_t* vMap = player->visibleMap;
-  grid_t* placesSeen = player->placesSeen;
-  if (vMap == NULL || placesSeen == NULL) {
-    return;
-  }
-
-  // bad address
-  if (message_eqAddr(player->address, message_noAddr())) {
-    return;
-  }
-
-  // get string from grids
-  char* vMapString = grid_getMap(vMap);
-  char* placesSeenString = grid_getMap(placesSeen);
-
-
-  if (vMapString == NULL || placesSeenString == NULL) {
-    return;
-  }
-
-  // add prefix for message_send
-  int prefixLen = 8; // GIVEN
-  int mapLen = grid_getLength(placesSeen);
-  int totalLen = prefixLen + mapLen + 1; // for null terminator
-
-  char *message = malloc(totalLen);
-  if (message == NULL) return; // out of memory
-
-  // add on prefix
-  snprintf(message, totalLen, "DISPLAY\n%s", placesSeenString);
-
-  for (int i = 0; i < mapLen; i++) {
-    char c = vMapString[i];
-    if (c == '*' || (c >= 'A' && c <= 'Z')) {
-      message[i+prefixLen] = c;
-    }
+    return false;
   }
 
-  message[player->location + prefixLen] = '@'; // replace own char with @ sign
-
-  // send message to address stored in player
-  message_send(player->address, message);
-
-  // free
-  free(message);
-}
-
-void printSpectatorMap(addr_t spectatorAddr, hashtable_t *playerLocations, grid_t *entireMap)
-{
-  // check for bad args
-  if (playerLocations == NULL || message_eqAddr(spectatorAddr, message_noAddr()) || entireMap == NULL)
+  // a late tick does not try to catch up
+  args->next += args->interval;
+  if (args->next < time)
   {
-    return;
+    args->next = time + args->interval;
   }
-
-  size_t prefixLen = 8;
-  int mapLen = grid_getLength(entireMap);
-  size_t totalLen = prefixLen + mapLen + 1; // for null terminator
-
-  char *message = malloc(totalLen);
-  if (message == NULL) return; // out of memory
-
-  // write into the message
-  snprintf(message, totalLen, "DISPLAY\n%s", grid_getMap(entireMap));
-
-  // add players' chars
-  hashtable_iterate(playerLocations, message, addPlayersToMap);
-
-  message_send(spectatorAddr, message);
-
-  free(message);
+  return game_tick(args->game);
 }
 
-// a function to add player's char to each player's location on a map
-void addPlayersToMap(void *arg, const char *key, void *item)
+void flushPaced(messageArgs_t *args)
 {
-  if (item == NULL || arg == NULL) return;
-
-  // cast arg and item
-  player_t *player = (player_t *)item;
-  char *mapString = (char *)arg;
-
-  // can guarentee 8 bc of prefixLen
-  if (player->location >= 8)
+  pacer_t *pacer = &args->clients->pacer;
+  if (pacer->interval <= 0)
   {
-    mapString[player->location + 8] = player->playerChar;
+    game_flush(args->game);
+    return;
   }
-}
-
-// Will go to the 1 before the closest wall or
-// if in a corridor will go to farthest '#'
-int newSprintedLocation(grid_t *entireMap, player_t *curPlayer, char move, const char *playerCharAddress, hashtable_t *goldRemaining, hashtable_t *playerLocations, int *walls, int currentPlayerLocation, addr_t spectator)
-{
 
-  int width = grid_getWidth(entireMap) + 1;
-  int prevLoc = curPlayer->location; // 2 back
-  int nextLoc = curPlayer->location; // 0 back
-  int curLoc = curPlayer->location;  // 1 back
-  
-  char charMapSpot = grid_get(entireMap, curLoc);
-
-  // Based off of:
-  // y k u
-  // h @ l
-  // b j n
-
-  // Keep going up/down/right/left until you hit a wall or " " (meaning end of cooridor)
-  while (charMapSpot != '|' && charMapSpot != '-' && charMapSpot != '+' && charMapSpot != ' ')
+  // top up every bucket, and hold whoever is out of tokens (but not the last frame of the game)
+  double time = now();
+  bool over = game_over(args->game);
+  for (int i = 0; i <= GAME_MAX_PLAYERS; i++)
   {
-    // update new then have old become new
-    prevLoc = curLoc; // 1 back = 2 back, will then be
-    curLoc = nextLoc; // 2 back = 0 back, will then be 1 back
-    if (move == 'H')
-    {
-      nextLoc = prevLoc - 1; // making 0 back
-    }
-    else if (move == 'Y')
+    pacer->tokens[i] += (time - pacer->refilled[i]) / pacer->interval;
+    if (pacer->tokens[i] > pacer->burst)
     {
-      nextLoc = prevLoc - width - 1;
+      pacer->tokens[i] = pacer->burst;
     }
-    else if (move == 'K')
-    {
-      nextLoc = prevLoc - width;
-    }
-    else if (move == 'U')
-    {
-      nextLoc = prevLoc - width + 1;
-    }
-    else if (move == 'L')
-    {
-      nextLoc = prevLoc + 1;
-    }
-    else if (move == 'N')
-    {
-      nextLoc = prevLoc + width + 1;
-    }
-    else if (move == 'J')
-    {
-      nextLoc = prevLoc + width;
-    }
-    else if (move == 'B')
-    {
-      nextLoc = prevLoc + width - 1;
-    }
-    else
-    {
-      log_e("Something went very wrong in SPRINT\n");
-      return -1;
-    }
-
-    
-
-    // set the next location
-    charMapSpot = grid_get(entireMap, nextLoc);
-
-    // set player New Location
-    curPlayer->location = curLoc;
-
-    // call updateVisibility and updateGold
-    updateGold(goldRemaining, playerLocations, curPlayer->address, playerCharAddress, curLoc);
-    updateVisibility(entireMap, curPlayer, walls, goldRemaining, curLoc);
-    changeAllVisibleMaps(entireMap, goldRemaining, playerLocations, curPlayer, prevLoc, curLoc);
+    pacer->refilled[i] = time;
+    bool held = !over && pacer->tokens[i] < 1;
+    pacer->release[i] = held ? time + (1 - pacer->tokens[i]) * pacer->interval : 0;
+    game_hold(args->game, i < GAME_MAX_PLAYERS ? i : GAME_SPECTATOR, held);
   }
 
-  // Sends visible map to all players
-  printAllVisibleMaps(playerLocations);
-  printSpectatorMap(spectator, playerLocations, entireMap);
-  return curLoc;
-}
+  game_flush(args->game);
 
-// updates the goldRemaining set.
-// ***ALSO updates the players gold
-void updateGold(hashtable_t *goldRemaining, hashtable_t *playerLocations, addr_t playerADDRAddress, const char *playerCharAddress, int newPlayerLoc)
-{
-  // look if there's a spot of gold in the new location
-  // ****************** CHANGE newPlayerLoc INTO A STRING ***********************
-  char locKey[20];
-  snprintf(locKey, sizeof(locKey), "%d", newPlayerLoc);
-
-  // get gold amount. goldAmount = -1 means its been taken.
-  // Therefor if <0 do nothing
-  int *goldAmount = hashtable_find(goldRemaining, locKey);
-  int justPickedUp = 0;
-  if (goldAmount != NULL && *goldAmount > 0)
+  // whoever was sent a frame pays for it
+  for (int i = 0; i <= GAME_MAX_PLAYERS; i++)
   {
-    justPickedUp = *goldAmount;
-
-    // Setting the gold
-    player_t *curPlayer = hashtable_find(playerLocations, playerCharAddress);
-    if (curPlayer != NULL)
+    if (pacer->sent[i])
     {
-      int prevGold = curPlayer->gold;
-      int curGold = prevGold + *goldAmount;
-      curPlayer->gold = curGold;
+      pacer->sent[i] = false;
+      pacer->tokens[i] -= 1;
     }
-
-    // Mskr the seen gold -1 so it is no longer seen
-    *goldAmount = -1;
-    goldUpdateMessage(playerLocations, goldRemaining, playerADDRAddress, justPickedUp);
   }
 }
 
-// In order to give the client display infromation, we must give them a gold update message
-// This message has form GOLD n p r (number picked up, purse gold, remaining nuggets)
-void goldUpdateMessage(hashtable_t *playerLocations, hashtable_t *goldRemaining, addr_t pickedUpAddr, int goldAmount)
+double now(void)
 {
-
-  // predefine a struct for passing multiple args into out goldUpdate hashtable_iterate
-  typedef struct
-  {
-    int goldPickedUp;
-    addr_t pickedUpAddr;
-    int nuggetsRemaining;
-  } goldUpdateData_t;
-
-
-  // check for bad arguments passed or if there is no gold
-  if (playerLocations == NULL || goldRemaining == NULL || goldAmount <= 0)
-  {
-    return;
-  }
-
-  // calculate total gold left
-  int nuggetsRemaining = 0;
-  hashtable_iterate(goldRemaining, &nuggetsRemaining, sumRemainingGold);
-
-  // create struct to give data to iterate
-  goldUpdateData_t goldData;
-  goldData.goldPickedUp = goldAmount;
-  goldData.pickedUpAddr = pickedUpAddr;
-  goldData.nuggetsRemaining = nuggetsRemaining;
-
-  hashtable_iterate(playerLocations, &goldData, sendGoldUpdate);
-
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
-// A helper function to find the remaining gold
-void sumRemainingGold(void *arg, const char *key, void *value)
+// check if we can add a player and if we can, add them
+int addNewPlayer(messageArgs_t *args, const char *username, addr_t givenAddress)
 {
-  int *goldAmount = (int *)value;
-  int *totalRemaining = (int *)arg;
+  clientTable_t *clients = args->clients;
+  int existingSlot = findPlayer(clients, givenAddress);
 
-  // only add if it is positive since we assign -1 for empty piles picked up
-  if (goldAmount != NULL && *goldAmount > 0)
+  if (existingSlot >= 0)
   {
-    *totalRemaining += *goldAmount;
+    // address already in table
+    if (game_isActive(args->game, existingSlot))
+    {
+      log_s("Tried to reactivate active player at %s", message_stringAddr(givenAddress));
+      return -1;
+    }
+    // back in the slot they left
+    return game_rejoin(args->game, existingSlot, username);
   }
-}
 
-// a helper function that iterates over a hashtable and sends an update message about gold
-void sendGoldUpdate(void *arg, const char *key, void *value)
-{
-
-  struct {
-    int goldPickedUp;
-    addr_t pickedUpAddr;
-    int nuggetsRemaining;
-  } *goldData = arg;
-
-  player_t *player = (player_t *)value;
-  if (player == NULL)
+  // new players get the next slot; remember who is playing it before the game says OK
+  int slot = game_numPlayers(args->game);
+  if (slot >= GAME_MAX_PLAYERS)
   {
-    return; // weird value
+    return -1;
   }
-
-  // determine gold picked up which is either 0 or actual value for on picker
-  int goldForThisPlayer = message_eqAddr(player->address, goldData->pickedUpAddr) ? goldData->goldPickedUp : 0;
-
-  // send actual message out
-  char message[50];
-  snprintf(message, sizeof(message), "GOLD %d %d %d", goldForThisPlayer, player->gold, goldData->nuggetsRemaining); // fill in everything
-
-  message_send(player->address, message);
-}
-
-// Look through all the players and update their visibleMaps, placesSeen, gold, etc.
-void changeAllVisibleMaps(grid_t *entireMap, hashtable_t *goldRemaining, hashtable_t *playerLocations, player_t *curPlayer, int oldLoc, int newLoc)
-{
-
-  // first change the new VisibleString
-  // Assumes the grids won't be NULL
-  // Doing moved Player first
-  grid_t *newVisibleString = curPlayer->visibleMap;
-
-  grid_set(newVisibleString, oldLoc, grid_get(entireMap, oldLoc));
-  char curPlayerChar = curPlayer->playerChar;
-  grid_set(newVisibleString, newLoc, curPlayerChar);
-
-  int data[4] = {(int)curPlayerChar, oldLoc, newLoc, (int)grid_get(entireMap, oldLoc)};
-
-// Now need to change the entireMaps gold standing
-  hashtable_iterate(goldRemaining, entireMap, iterateGoldHashtable);
-
-  // Change for all players
-  hashtable_iterate(playerLocations, data, iteratePlayerHashtable);
-
-  //ITERATE THE MOVED PLAYER IF THERE ARE OTHER PLAYERS AROUND
-  hashtable_iterate(playerLocations, curPlayer, iterateMovedPlayer);
-}
-
-// If the moved player is visible then make them moved for all the other players
-void iterateMovedPlayer(void *movedPlayer, const char *address, void *curPlayer){
-  player_t *mPlayer = (player_t *)movedPlayer;
-  player_t *cPlayer = (player_t *)curPlayer;
-  grid_t *curVisibleMap = mPlayer->visibleMap;
-
-// if visibile then make moved
-  if(grid_get(curVisibleMap, cPlayer->location) != ' '){
-    grid_set(curVisibleMap, cPlayer->location, cPlayer->playerChar);
-  }
-}
-
-// get rid of all taken gold from entireMap
-void iterateGoldHashtable(void *entireMap, const char *goldLoc, void *goldAmount)
-{
-  // Assumes that gold has already been placed on the map
-  if ((*(int *)goldAmount) < 0)
+  clients->address[slot] = givenAddress;
+  if (game_join(args->game, username) != slot)
   {
-    grid_set((grid_t *)entireMap, atoi(goldLoc), '.');
+    clients->address[slot] = message_noAddr();
+    return -1;
   }
+  clients->index[addressIndexSlot(clients, givenAddress)] = slot + 1;
+  return slot;
 }
 
-void iteratePlayerHashtable(void *data, const char *address, void *player)
+// add a spectator at the end of the list, where GAME_NEW_SPECTATOR messages go
+bool addNewSpectator(clientTable_t *clients, const addr_t newAddress)
 {
-
-  // We are looking if the old spot is already visible
-  // Can I already see the other player?
-  // If I can then show the player moving
-  // If not then change nothing.
-  player_t *curPlayer = (player_t *)player;
-  grid_t *curVisibleMap = curPlayer->visibleMap;
-  // grid_t* curPlacesSeen = player -> placesSeen;
-  int *intData = (int *)data; // Cast to int*
-  char movedPlayerChar = (char)intData[0];
-  int oldLoc = intData[1];
-  int newLoc = intData[2];
-  char newLocInEntireMap = (char)intData[3];
-
-  
-  char oldVisible = grid_get(curVisibleMap, oldLoc);
-  char newVisible = grid_get(curVisibleMap, newLoc);
-
-  // If the spot is on the visibleMap then show the player moving
-  if (oldVisible != ' ')
+  int existing = findSpectator(clients, newAddress);
+  if (existing >= 0)
   {
-    grid_set(curVisibleMap, oldLoc, newLocInEntireMap);
+    // already watching: they are sent the grid and map again, like anyone new
+    removeSpectator(clients, existing);
   }
-  if (newVisible != ' ')
+  else if (clients->numSpectators == MAX_SPECTATORS)
   {
-    grid_set(curVisibleMap, newLoc, movedPlayerChar);
+    // don't forget to kick the old spectator
+    char *kickMessage = "QUIT You have been replaced by a new spectator.";
+    message_send(clients->spectators[0], kickMessage);
+    removeSpectator(clients, 0);
   }
-  curPlayer->visibleMap = curVisibleMap;
+  clients->spectators[clients->numSpectators++] = newAddress;
+  return true;
 }
 
-/***************** visibility ****************************/
-// check if Im in a cooridor
-bool twoSidedHash(int curPlayerLoc, grid_t *entireMap)
+int overviewScale(int rows, int cols)
 {
-  // look at how many of sides are "#"
-  //  only count to 4 (up, down, right, and left)
-  int hashCount = 0;
-  // Need width to know what to divide by
-  int width = grid_getWidth(entireMap) + 1;
-  // Need size to know if we're out of bounds
-  int mapSize = grid_getLength(entireMap);
-
-  // Check all 4 sides
-  if (grid_get(entireMap, curPlayerLoc + 1) == '#')
-  {
-    hashCount++;
-  }
-  if (grid_get(entireMap, curPlayerLoc - 1) == '#')
+  int scale = 1;
+  while (!windowFits((rows + scale - 1) / scale, (cols + scale - 1) / scale))
   {
-    hashCount++;
+    scale++;
   }
-  if ((curPlayerLoc + width) < mapSize && grid_get(entireMap, curPlayerLoc + width) == '#')
-  {
-    hashCount++;
-  }
-  if ((curPlayerLoc - width) < 0 && grid_get(entireMap, curPlayerLoc - width) == '#')
-  {
-    hashCount++;
-  }
-
-  // if exactly 2 sides are #s then we are in a cooridor
-  if (hashCount > 1)
-  {
-    return true;
-  }
-  if (hashCount == 1)
-  {
-    // Look if the cooridor goes to nowhere
-    if (grid_get(entireMap, curPlayerLoc + 1) == ' ' || grid_get(entireMap, curPlayerLoc - 1) == ' ' || grid_get(entireMap, curPlayerLoc + width) == ' ' || grid_get(entireMap, curPlayerLoc - width) == ' ')
-    {
-      return true;
-    }
-  }
-  return false;
-}
-
-void freeItem(void *item)
-{
-  free(item);
+  return scale;
 }
 
-// lot of memory allocation to insertSet, also called multiple times
-void insertSet(set_t *goodDiagonal, grid_t *entireMap, int roundedCurPoint, int startPoint)
+// rows of cols chars and a newline, plus the game's window header, must fit in message_MaxBytes;
+// the sizes may be the client's, so they are compared against the room left, never added to
+bool windowFits(int rows, int cols)
 {
-  // Don't want to add startPoint b/c it might be a hash
-  // frees in set_delete
-  char *key = malloc(((int)ceil(log(grid_getLength(entireMap))) + 1) * sizeof(char));
-  sprintf(key, "%d", roundedCurPoint);
-  // Need to put item of heap not stack
-  char *item = malloc(sizeof(char) + sizeof(char));
-  item[0] = grid_get(entireMap, roundedCurPoint);
-  item[1] = '\0';
-  // Add to a set that will then be sent back to super function to be used on visibleMap
-  set_insert(goodDiagonal, key, item);
-}
-
-// Limit visibility if distance between sPt and ePt is >5
-bool visLimit(int startPoint, int endPoint, int width){
-  int wDiff = abs((endPoint%width) - (startPoint%width));
-  double hDiff = round(abs(((double)endPoint)/width) - (((double)startPoint)/width));
-
-  // Using pythagorean theorm
-  if((wDiff*wDiff)+(hDiff*hDiff) > 25){
-    return true;
-  }
-  return false;
+  int room = message_MaxBytes - GAME_WINDOW_HEADER_MAX;
+  return rows <= 0 || cols <= 0 || (cols < room && rows <= room / (cols + 1));
 }
 
-// Return the set of the diagonal between position and wall if none of the spaces between are walls or spaces
-// Else return NULL
-set_t *spaceBetween(int curWall, int curPlayerLoc, grid_t *entireMap)
+// a linear search: there are only a few spectators
+int findSpectator(clientTable_t *clients, addr_t address)
 {
-  int width = grid_getWidth(entireMap) + 1;
-  // See if there is a " " between wall and player
-  // If so then we won't consider it
-
-  // + therefore player is left of wall.
-  // - therfore player is right of wall.
-  int widthDifference = (curWall % width) - (curPlayerLoc % width);
-
-  // + therefore player is above of wall.
-  // - therfore player is below of wall.
-  int heightDifference = ((int)floor(curWall / width)) - ((int)floor(curPlayerLoc / width));
-
-  // Check how many points in between (Pythagorean Theorm)
-  double pointsInBetween = sqrt((heightDifference * heightDifference) + (widthDifference * widthDifference));
-
-  // check all the points in between player and wall
-  double exactCeilCurPoint = curPlayerLoc;
-
-  double exactFloorCurPoint = curPlayerLoc;
-
-  double exactHeightMove = (heightDifference / pointsInBetween) * width;
-
-  double exactWidthMove = widthDifference / pointsInBetween;
-
-  double curHMove = 0.0;
-  double curWMove = 0.0;
-  int startPoint = curPlayerLoc;
-
-  int roundedCeilCurPoint = (int)round(exactCeilCurPoint);
-
-  int roundedFloorCurPoint = (int)round(exactFloorCurPoint);
-
-  // USing Ceil and Floor so that we can see both sides of the diagonal (more accurate)
-  bool floorHit = false;
-  bool ceilHit = false;
-
-  // don't want to consider starting point
-  bool isFirst = true;
-
-  // set for storing good indexes
-  //  set: key= (int) map index, item= (char) map char at spot
-  set_t *goodDiagonal = set_new();
-
-  while (roundedCeilCurPoint != curWall && roundedFloorCurPoint != curWall)
+  for (int i = 0; i < clients->numSpectators; i++)
   {
-    // most common is " ", but still need to check for |,-,+
-
-    if (!isFirst && (grid_get(entireMap, roundedCeilCurPoint) == ' ' || grid_get(entireMap, roundedCeilCurPoint) == '|' || grid_get(entireMap, roundedCeilCurPoint) == '-' || grid_get(entireMap, roundedCeilCurPoint) == '+' || grid_get(entireMap, roundedCeilCurPoint) == '#'))
+    if (message_eqAddr(clients->spectators[i], address))
     {
-      if (floorHit)
-      {
-        set_delete(goodDiagonal, freeItem);
-        
-        return NULL;
-      }
-      ceilHit = true;
+      return i;
     }
-
-    if (!isFirst && (grid_get(entireMap, roundedFloorCurPoint) == ' ' || grid_get(entireMap, roundedFloorCurPoint) == '|' || grid_get(entireMap, roundedFloorCurPoint) == '-' || grid_get(entireMap, roundedFloorCurPoint) == '+' || grid_get(entireMap, roundedFloorCurPoint) == '#'))
-    {
-      if (ceilHit)
-      {
-        set_delete(goodDiagonal, freeItem);
-
-        return NULL;
-      }
-      floorHit = true;
-    }
-
-    // Width greater than height than floor and ceil height
-    if (abs(heightDifference) < abs(widthDifference))
-    {
-      if(!ceilHit && !visLimit(startPoint, roundedCeilCurPoint, width)){insertSet(goodDiagonal, entireMap, roundedCeilCurPoint, startPoint);}
-      if(!floorHit && !visLimit(startPoint, roundedFloorCurPoint, width)){insertSet(goodDiagonal, entireMap, roundedFloorCurPoint, startPoint);}
-
-      // update the exact and rounded
-      curHMove += exactHeightMove;
-      curWMove += exactWidthMove;
-      exactCeilCurPoint = startPoint + curWMove + ceil(curHMove / width) * width;
-      exactFloorCurPoint = startPoint + curWMove + floor(curHMove / width) * width;
-      roundedCeilCurPoint = (int)round(exactCeilCurPoint);
-      roundedFloorCurPoint = (int)round(exactFloorCurPoint);
-      isFirst = false;
-    }
-    else
-    {
-      if(!ceilHit && !visLimit(startPoint, roundedCeilCurPoint, width)){insertSet(goodDiagonal, entireMap, roundedCeilCurPoint, startPoint);}
-      if(!floorHit && !visLimit(startPoint, roundedFloorCurPoint, width)){insertSet(goodDiagonal, entireMap, roundedFloorCurPoint, startPoint);}
-
-      // else floor and ceil width
-      curHMove += exactHeightMove;
-      curWMove += exactWidthMove;
-      exactCeilCurPoint = startPoint + curWMove + round(curHMove / width) * width;
-      exactFloorCurPoint = startPoint + curWMove + round(curHMove / width) * width;
-      roundedCeilCurPoint = (int)ceil(exactCeilCurPoint);
-      roundedFloorCurPoint = (int)floor(exactFloorCurPoint);
-      isFirst = false;
-    }
-  }
-  // Need to add the wall too
-  if(!visLimit(startPoint, curWall, width)){
-    insertSet(goodDiagonal, entireMap, curWall, startPoint);
   }
-  //  return true if no spaces
-  return goodDiagonal;
+  return -1;
 }
 
-// updating the visible map with all seeable points (gold and characters included (chars not here tho))
-void updateDiagonalVisibleMap(void *arg, const char *key, void *item)
+// close the gap, so the newest stays last
+void removeSpectator(clientTable_t *clients, int i)
 {
-  grid_t *grid = (grid_t *)arg;
-  int index = atoi(key);
-  char dot = *(char *)item;
-
-  grid_set(grid, index, dot);
+  for (; i + 1 < clients->numSpectators; i++)
+  {
+    clients->spectators[i] = clients->spectators[i + 1];
+  }
+  clients->numSpectators--;
 }
 
-// updating the placesSeen so that only . will appear
-void updateDiagonalPlacesSeen(void *arg, const char *key, void *item)
+// look the address up in the index
+int findPlayer(clientTable_t *clients, addr_t address)
 {
-
-  grid_t *grid = (grid_t *)arg;
-  int index = atoi(key);
-  char dot = *(char *)item;
-
-  if(dot == '*'){
-    dot = '.';
-  }
-
-  grid_set(grid, index, dot);
+  return clients->index[addressIndexSlot(clients, address)] - 1;
 }
 
-// updating visibility in the new Location
-void updateVisibility(grid_t *entireMap, player_t *player, int *walls, hashtable_t *goldRemaining, int oldLoc)
+// linear probing from a hash of the raw ip and port; the index is never
+// more than half full, so there is always an empty entry to stop at
+int addressIndexSlot(clientTable_t *clients, addr_t address)
 {
-  // This is the newLoc
-  int curPlayerLoc = player->location;
-  // This is all the places player has been
-  grid_t *placesSeen = player->placesSeen;
-  grid_t *visibleMap = player->visibleMap;
-  int width = grid_getWidth(entireMap) + 1;
-
-  // See if we're in a coridor
-  // If so then just update visible map with hashtags
-  if (twoSidedHash(curPlayerLoc, entireMap))
+  uint32_t hash = (uint32_t)address.sin_addr.s_addr * 0x9e3779b1u ^ (uint32_t)address.sin_port * 0x85ebca6bu;
+  int i = (hash >> 16) & (ADDRESS_INDEX_SIZE - 1);
+  while (clients->index[i] != 0 && !message_eqAddr(clients->address[clients->index[i] - 1], address))
   {
-    // update all 4 spots around the current position
-    //  they should only be " " or "#"
-
-    // Setting places I've been
-    grid_set(placesSeen, curPlayerLoc + 1, grid_get(entireMap, curPlayerLoc + 1));
-    grid_set(placesSeen, curPlayerLoc - 1, grid_get(entireMap, curPlayerLoc - 1));
-    grid_set(placesSeen, curPlayerLoc + width, grid_get(entireMap, curPlayerLoc + width));
-    grid_set(placesSeen, curPlayerLoc - width, grid_get(entireMap, curPlayerLoc - width));
-
-    // Setting the Visible Map (what I can see)
-    // This should be all the way down all the cooridors
-    // NO!!! You can only see 1 in front of you in a dark cooridor
-    grid_makeEmpty(visibleMap);
-    grid_set(visibleMap, curPlayerLoc + 1, grid_get(entireMap, curPlayerLoc + 1));
-    grid_set(visibleMap, curPlayerLoc - 1, grid_get(entireMap, curPlayerLoc - 1));
-    grid_set(visibleMap, curPlayerLoc + width, grid_get(entireMap, curPlayerLoc + width));
-    grid_set(visibleMap, curPlayerLoc - width, grid_get(entireMap, curPlayerLoc - width));
-
-    
-    player->placesSeen = placesSeen;
-    player->visibleMap = visibleMap;
+    i = (i + 1) & (ADDRESS_INDEX_SIZE - 1);
   }
-  else
-  {
-    // else will need to do visibility and other updated
-    //  Grid has function to get all the wall pointers
-    int wallsIndex = 0;
-    int curWall;
-
-    
-    // Resetting the visibleMap
-    grid_makeEmpty(visibleMap);
-
-    // Look at every wall as long as there are more walls left
-    while ((curWall = walls[wallsIndex]) != -1)
-    {
-      // Only consider walls that are have no " " (therefore no other walls) between
-      // the wall and the player (player position)
-
-      // creating a diagonal of good entries for wall to player
-      set_t *diagonal;
-
-      if ((diagonal = spaceBetween(curWall, curPlayerLoc, entireMap)) != NULL)
-      {
-        //  update every spot in the diagonal (maximum of sqrt(width^2+height^2) updates)
-        set_iterate(diagonal, visibleMap, updateDiagonalVisibleMap);
-        set_iterate(diagonal, placesSeen, updateDiagonalPlacesSeen);
-        set_delete(diagonal, freeItem);
-      }
-      wallsIndex++;
-    }
-    // Need function that will add the other playerLocs and goldRemaing
-    // Should do this in space in updateGold and updatePlayerLocations
-    // Otherwise will be too inefficient
-
-    player->placesSeen = placesSeen;
-    player->visibleMap = visibleMap;
-
-  }
-}
\ No newline at end of file
+  return i;
+}
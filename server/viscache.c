@@ -0,0 +1,286 @@
+/*
+ * viscache.c - implementation file for the visibility cache module
+ *
+ * Direct-mapped cache of visibility results plus one helper thread that
+ * fills it from a queue of requested cells. One mutex guards the slots,
+ * the queue and the counters; visibility itself is computed outside it.
+ * See viscache.h for more information.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "viscache.h"
+#include "visibility.h"
+
+/**************** file-local global variables ****************/
+static const int QUEUE_SIZE = 256;  // pending requests kept for the helper
+
+/**************** local types ****************/
+typedef struct cacheEntry {
+    int loc;            // map index this entry is for, -1 if empty
+    bool speculative;   // filled by the helper thread (not on a miss)
+    bool used;          // looked up at least once since it was filled
+    int count;          // number of visible cells
+    int* cells;         // the visible cells
+} cacheEntry_t;
+
+/**************** global types ****************/
+typedef struct viscache {
+    visibility_t* vis;
+    int slots;              // number of entries
+    int maxCells;           // capacity of each entry
+    cacheEntry_t* entries;
+
+    int* queue;             // ring of requested cells
+    int queueHead;          // index of oldest request
+    int queueCount;         // number of requests waiting
+
+    pthread_t helper;
+    pthread_mutex_t lock;   // guards everything below and above
+    pthread_cond_t wake;    // signalled when requests arrive or on stop
+    bool started;
+    bool stopping;
+
+    long hits;              // lookups answered from the cache
+    long misses;            // lookups computed on the game thread
+    long precomputed;       // entries filled by the helper thread
+    long wasted;            // precomputed entries dropped without a hit
+    long alreadyWarm;       // requests skipped because they were cached
+} viscache_t;
+
+/**************** local functions ****************/
+static void* helperMain(void* arg);
+static cacheEntry_t* slotFor(viscache_t* cache, int loc);
+static void fillEntry(viscache_t* cache, int loc, const int* cells, int count, bool speculative);
+
+
+/**************** viscache_new ****************/
+/* Create the cache and start its helper thread.
+ * See viscache.h for more information. */
+viscache_t* viscache_new(visibility_t* vis, int slots)
+{
+    // validate parameters
+    if (vis == NULL || slots <= 0){
+        return NULL;
+    }
+
+    viscache_t* cache = calloc(1, sizeof(viscache_t));
+    if (cache == NULL){
+        fprintf(stderr, "Error: issue allocating memory in viscache_new\n");
+        return NULL;
+    }
+    cache->vis = vis;
+    cache->slots = slots;
+    cache->maxCells = visibility_maxCells(vis);
+    cache->entries = calloc(slots, sizeof(cacheEntry_t));
+    cache->queue = malloc(QUEUE_SIZE * sizeof(int));
+    if (cache->entries == NULL || cache->queue == NULL){
+        fprintf(stderr, "Error: issue allocating memory in viscache_new\n");
+        viscache_delete(cache);
+        return NULL;
+    }
+
+    // every entry gets room for the largest possible result
+    for (int i = 0; i < slots; i++){
+        cache->entries[i].loc = -1;
+        cache->entries[i].cells = malloc(cache->maxCells * sizeof(int));
+        if (cache->entries[i].cells == NULL){
+            fprintf(stderr, "Error: issue allocating memory in viscache_new\n");
+            viscache_delete(cache);
+            return NULL;
+        }
+    }
+
+    pthread_mutex_init(&cache->lock, NULL);
+    pthread_cond_init(&cache->wake, NULL);
+    if (pthread_create(&cache->helper, NULL, helperMain, cache) != 0){
+        fprintf(stderr, "Error: could not start visibility helper thread\n");
+        pthread_mutex_destroy(&cache->lock);
+        pthread_cond_destroy(&cache->wake);
+        free(cache->queue);
+        for (int i = 0; i < slots; i++){
+            free(cache->entries[i].cells);
+        }
+        free(cache->entries);
+        free(cache);
+        return NULL;
+    }
+    cache->started = true;
+    return cache;
+}
+
+
+/**************** viscache_get ****************/
+/* Copy the cells visible from loc into cells, computing on a miss.
+ * See viscache.h for more information. */
+int viscache_get(viscache_t* cache, int loc, int* cells)
+{
+    pthread_mutex_lock(&cache->lock);
+    cacheEntry_t* entry = slotFor(cache, loc);
+    if (entry->loc == loc){
+        int count = entry->count;
+        memcpy(cells, entry->cells, count * sizeof(int));
+        entry->used = true;
+        cache->hits++;
+        pthread_mutex_unlock(&cache->lock);
+        return count;
+    }
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    // compute it ourselves, then keep it for next time
+    int count = visibility_compute(cache->vis, loc, cells);
+    pthread_mutex_lock(&cache->lock);
+    fillEntry(cache, loc, cells, count, false);
+    pthread_mutex_unlock(&cache->lock);
+    return count;
+}
+
+
+/**************** viscache_request ****************/
+/* Queue cells for the helper thread.
+ * See viscache.h for more information. */
+void viscache_request(viscache_t* cache, const int* locs, int n)
+{
+    if (cache == NULL || locs == NULL){
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < n; i++){
+        if (slotFor(cache, locs[i])->loc == locs[i]){
+            cache->alreadyWarm++;
+            continue;
+        }
+        // drop the oldest request when full; it is the stalest
+        if (cache->queueCount == QUEUE_SIZE){
+            cache->queueHead = (cache->queueHead + 1) % QUEUE_SIZE;
+            cache->queueCount--;
+        }
+        cache->queue[(cache->queueHead + cache->queueCount) % QUEUE_SIZE] = locs[i];
+        cache->queueCount++;
+    }
+    pthread_cond_signal(&cache->wake);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+
+/**************** viscache_report ****************/
+/* Print cache statistics.
+ * See viscache.h for more information. */
+void viscache_report(viscache_t* cache, FILE* fp)
+{
+    if (cache == NULL || fp == NULL){
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    long lookups = cache->hits + cache->misses;
+    fprintf(fp, "visibility cache: %ld lookups, %ld hits (%.1f%%), %ld misses\n",
+            lookups, cache->hits, lookups ? 100.0 * cache->hits / lookups : 0.0, cache->misses);
+    fprintf(fp, "visibility cache: %ld precomputed, %ld wasted (%.1f%%), %ld requests already warm\n",
+            cache->precomputed, cache->wasted,
+            cache->precomputed ? 100.0 * cache->wasted / cache->precomputed : 0.0, cache->alreadyWarm);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+
+/**************** viscache_delete ****************/
+/* Stop the helper thread and free the cache.
+ * See viscache.h for more information. */
+void viscache_delete(viscache_t* cache)
+{
+    if (cache == NULL){
+        return;
+    }
+    if (cache->started){
+        pthread_mutex_lock(&cache->lock);
+        cache->stopping = true;
+        pthread_cond_signal(&cache->wake);
+        pthread_mutex_unlock(&cache->lock);
+        pthread_join(cache->helper, NULL);
+        pthread_mutex_destroy(&cache->lock);
+        pthread_cond_destroy(&cache->wake);
+    }
+    if (cache->entries != NULL){
+        for (int i = 0; i < cache->slots; i++){
+            free(cache->entries[i].cells);
+        }
+    }
+    free(cache->entries);
+    free(cache->queue);
+    free(cache);
+}
+
+
+/**************** helperMain ****************/
+/* Helper thread: take requests off the queue and fill the cache. */
+static void* helperMain(void* arg)
+{
+    viscache_t* cache = arg;
+    // the game thread computes misses with vis's own buffers, so use ours
+    int* cells = malloc(cache->maxCells * sizeof(int));
+    visScratch_t* scratch = visibility_newScratch(cache->vis);
+    if (cells == NULL || scratch == NULL){
+        free(cells);
+        visibility_deleteScratch(scratch);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    while (!cache->stopping){
+        if (cache->queueCount == 0){
+            pthread_cond_wait(&cache->wake, &cache->lock);
+            continue;
+        }
+        int loc = cache->queue[cache->queueHead];
+        cache->queueHead = (cache->queueHead + 1) % QUEUE_SIZE;
+        cache->queueCount--;
+
+        // someone may have filled it since it was requested
+        if (slotFor(cache, loc)->loc == loc){
+            continue;
+        }
+
+        // compute without holding the lock so the game thread never waits
+        pthread_mutex_unlock(&cache->lock);
+        int count = visibility_computeIn(cache->vis, scratch, loc, cells);
+        pthread_mutex_lock(&cache->lock);
+
+        fillEntry(cache, loc, cells, count, true);
+        cache->precomputed++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    free(cells);
+    visibility_deleteScratch(scratch);
+    return NULL;
+}
+
+
+/**************** slotFor ****************/
+/* Return the entry loc maps to. Caller holds the lock. */
+static cacheEntry_t* slotFor(viscache_t* cache, int loc)
+{
+    return &cache->entries[(unsigned)loc % (unsigned)cache->slots];
+}
+
+
+/**************** fillEntry ****************/
+/* Store a result in loc's slot, counting an evicted unused precompute as
+ * wasted. Caller holds the lock. */
+static void fillEntry(viscache_t* cache, int loc, const int* cells, int count, bool speculative)
+{
+    cacheEntry_t* entry = slotFor(cache, loc);
+    if (entry->loc != -1 && entry->speculative && !entry->used){
+        cache->wasted++;
+    }
+    entry->loc = loc;
+    entry->speculative = speculative;
+    entry->used = false;
+    entry->count = count;
+    memcpy(entry->cells, cells, count * sizeof(int));
+}
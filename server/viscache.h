@@ -0,0 +1,69 @@
+/*
+ * viscache.h - header file for the visibility cache module
+ *
+ * A viscache keeps recently computed visibility results, keyed by map
+ * index, in a fixed number of direct-mapped slots. A helper thread fills
+ * the cache ahead of time with cells players are likely to move to next,
+ * so the game thread almost always finds a warm entry.
+ *
+ * This module is used by the visibility module; the server does not
+ * talk to it directly.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#ifndef __VISCACHE_H
+#define __VISCACHE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "visibility.h"
+
+
+/**************** global types ****************/
+typedef struct viscache viscache_t;
+
+
+/**************** functions ****************/
+
+/**************** viscache_new ****************/
+/* Create a cache with the given number of slots and start its helper
+ * thread, which computes entries with visibility_compute.
+ *
+ * Notes:
+ *   returns NULL if memory or the thread cannot be had
+ *   caller is responsible for calling viscache_delete
+ */
+viscache_t* viscache_new(visibility_t* vis, int slots);
+
+
+/**************** viscache_get ****************/
+/* Copy the cells visible from loc into cells and return how many.
+ *
+ * On a hit the cached entry is copied; on a miss the entry is computed
+ * right away on the calling thread and then kept in the cache.
+ * cells must hold visibility_maxCells(vis) ints.
+ */
+int viscache_get(viscache_t* cache, int loc, int* cells);
+
+
+/**************** viscache_request ****************/
+/* Ask the helper thread to precompute the given cells.
+ *
+ * Cells already in the cache are skipped. If the queue is full the
+ * oldest requests are dropped, since newer moves make them stale.
+ */
+void viscache_request(viscache_t* cache, const int* locs, int n);
+
+
+/**************** viscache_report ****************/
+/* Print hits, misses, precomputed and wasted (evicted unused) entries. */
+void viscache_report(viscache_t* cache, FILE* fp);
+
+
+/**************** viscache_delete ****************/
+/* Stop and join the helper thread, then free the cache. */
+void viscache_delete(viscache_t* cache);
+
+#endif // __VISCACHE_H
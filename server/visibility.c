@@ -0,0 +1,840 @@
+/*
+ * visibility.c - implementation file for visibility module
+ *
+ * Line-of-sight for a single map. See visibility.h for more information.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "visibility.h"
+#include "viscache.h"
+#include "vistable.h"
+#include "grid.h"
+
+/**************** file-local global variables ****************/
+static const int CULL_REACH = 4;    // see visibility_computeWith in visibility.h
+static const char* STRATEGY_NAMES[] = {"ray", "region", "table", "cache"};
+
+/**************** local types ****************/
+// buffers for one computation at a time, kept between computations
+struct visScratch {
+    unsigned char* box;     // one byte per cell of the box around loc, all 0 between calls
+    int* ray;
+    int rayCap;
+};
+
+/**************** global types ****************/
+typedef struct visibility {
+    char* terrain;      // copy of the map with gold turned back into floor
+    int width;          // grid width + 1 (for the '\n')
+    int length;         // strlen(terrain)
+    int* walls;         // indices of every obstruction, -1 terminated
+    int radius;         // visibility radius in cells
+    int boxWidth;       // columns of the box around loc that can be visible
+    int boxHeight;      // rows of that box
+    int maxCells;       // most cells a computation can report
+    int* cells;         // result buffer handed out by visibility_get
+    visBackend_t backend;   // how visibility_compute works
+    unsigned char* solid;   // per cell: it and its 8 neighbours all block sight
+    int* region;            // per cell: its region (see buildRegions), 0 if solid or '\n'
+    int regions;
+    int* regionWallStart;   // walls near region r are regionWalls[regionWallStart[r]..[r+1]-1]
+    int* regionWalls;
+    visScratch_t* scratch;  // for computations on the thread that owns the object
+    viscache_t* cache;  // speculation cache, NULL unless started
+    vistable_t* table;  // compressed table of every open cell, NULL unless built
+} visibility_t;
+
+/**************** local functions ****************/
+static char terrainAt(visibility_t* vis, int index);
+static bool isObstruction(char c);
+static bool inCorridor(visibility_t* vis, int loc);
+static bool visLimit(visibility_t* vis, int startPoint, int endPoint);
+static int traceRay(visibility_t* vis, int curWall, int curPlayerLoc, int* ray, int rayCap);
+static bool markCell(visibility_t* vis, unsigned char* box, int loc, int cell);
+static int boxIndex(visibility_t* vis, int loc, int cell);
+static int sprintEnd(visibility_t* vis, int loc, int step);
+static bool buildRegions(visibility_t* vis);
+static int nearRegions(visibility_t* vis, int wall, int* found);
+static int traceWall(visibility_t* vis, visScratch_t* scratch, int wall, int loc, int* cells, int count);
+static int computeIn(visibility_t* vis, visScratch_t* scratch, visBackend_t backend, int loc, int* cells);
+
+
+/**************** visibility_new ****************/
+/* Create a visibility object for the given map.
+ * See visibility.h for more information. */
+visibility_t* visibility_new(grid_t* entireMap, int radius)
+{
+    // validate parameters
+    char* map = grid_getMap(entireMap);
+    if (map == NULL){
+        fprintf(stderr, "Error: NULL grid in visibility_new\n");
+        return NULL;
+    }
+    if (radius < 1){
+        fprintf(stderr, "Error: radius must be positive in visibility_new\n");
+        return NULL;
+    }
+
+    // create and allocate memory for new visibility object
+    visibility_t* vis = calloc(1, sizeof(visibility_t));
+    if (vis == NULL){
+        fprintf(stderr, "Error: issue allocating memory in visibility_new\n");
+        return NULL;
+    }
+
+    // copy the map, with gold as floor since gold never blocks sight
+    vis->length = grid_getLength(entireMap);
+    vis->width = grid_getWidth(entireMap) + 1;
+    vis->terrain = malloc(vis->length + 1);
+    vis->walls = grid_getWalls(entireMap);
+    if (vis->terrain == NULL || vis->walls == NULL){
+        fprintf(stderr, "Error: issue allocating memory in visibility_new\n");
+        visibility_delete(vis);
+        return NULL;
+    }
+    for (int i = 0; i <= vis->length; i++){
+        vis->terrain[i] = (map[i] == '*') ? '.' : map[i];
+    }
+
+    // every visible cell passes visLimit, which rounds rows so that a cell
+    // one row past the radius can sneak in; size the box for that
+    vis->radius = radius;
+    vis->boxWidth = 2 * vis->radius + 1;
+    vis->boxHeight = 2 * vis->radius + 3;
+    vis->maxCells = vis->boxWidth * vis->boxHeight;
+
+    vis->cells = malloc(vis->maxCells * sizeof(int));
+    vis->scratch = visibility_newScratch(vis);
+    if (vis->cells == NULL || vis->scratch == NULL || !buildRegions(vis)){
+        fprintf(stderr, "Error: issue allocating memory in visibility_new\n");
+        visibility_delete(vis);
+        return NULL;
+    }
+    vis->backend = VIS_BACKEND_REGION;
+    return vis;
+}
+
+
+/**************** visibility_maxCells ****************/
+/* Return the most cells a single computation can report.
+ * See visibility.h for more information. */
+int visibility_maxCells(visibility_t* vis)
+{
+    return (vis == NULL) ? 0 : vis->maxCells;
+}
+
+
+/**************** visibility_compute ****************/
+/* Compute the cells visible from loc into cells; return how many.
+ * See visibility.h for more information. */
+int visibility_compute(visibility_t* vis, int loc, int* cells)
+{
+    return (vis == NULL) ? 0 : visibility_computeWith(vis, vis->backend, loc, cells);
+}
+
+
+/**************** visibility_computeWith ****************/
+/* Compute the cells visible from loc with the given backend.
+ * See visibility.h for more information. */
+int visibility_computeWith(visibility_t* vis, visBackend_t backend, int loc, int* cells)
+{
+    return (vis == NULL) ? 0 : computeIn(vis, vis->scratch, backend, loc, cells);
+}
+
+
+/**************** visibility_newScratch ****************/
+/* Allocate buffers for computing on another thread.
+ * See visibility.h for more information. */
+visScratch_t* visibility_newScratch(visibility_t* vis)
+{
+    if (vis == NULL){
+        return NULL;
+    }
+    visScratch_t* scratch = calloc(1, sizeof(visScratch_t));
+    if (scratch == NULL){
+        return NULL;
+    }
+    // a ray keeps at most 2 cells a step while it is inside the box
+    scratch->rayCap = 2 * (vis->boxWidth + vis->boxHeight) + 4;
+    scratch->box = calloc(vis->maxCells, 1);
+    scratch->ray = malloc(scratch->rayCap * sizeof(int));
+    if (scratch->box == NULL || scratch->ray == NULL){
+        visibility_deleteScratch(scratch);
+        return NULL;
+    }
+    return scratch;
+}
+
+
+/**************** visibility_computeIn ****************/
+/* Compute the cells visible from loc with scratch's buffers.
+ * See visibility.h for more information. */
+int visibility_computeIn(visibility_t* vis, visScratch_t* scratch, int loc, int* cells)
+{
+    return (vis == NULL || scratch == NULL) ? 0 : computeIn(vis, scratch, vis->backend, loc, cells);
+}
+
+
+/**************** visibility_deleteScratch ****************/
+/* Free buffers made by visibility_newScratch.
+ * See visibility.h for more information. */
+void visibility_deleteScratch(visScratch_t* scratch)
+{
+    if (scratch == NULL){
+        return;
+    }
+    free(scratch->box);
+    free(scratch->ray);
+    free(scratch);
+}
+
+
+/**************** visibility_setBackend ****************/
+/* Choose the backend visibility_compute uses.
+ * See visibility.h for more information. */
+void visibility_setBackend(visibility_t* vis, visBackend_t backend)
+{
+    if (vis != NULL){
+        vis->backend = backend;
+    }
+}
+
+
+/**************** visibility_getRadius ****************/
+/* Return how far players can see.
+ * See visibility.h for more information. */
+int visibility_getRadius(visibility_t* vis)
+{
+    return (vis == NULL) ? 0 : vis->radius;
+}
+
+
+/**************** visibility_get ****************/
+/* Return the number of cells visible from loc and point *cells at them.
+ * See visibility.h for more information. */
+int visibility_get(visibility_t* vis, int loc, const int** cells)
+{
+    // validate parameters
+    if (vis == NULL || cells == NULL){
+        return 0;
+    }
+    *cells = vis->cells;
+
+    if (vis->table != NULL){
+        int count = vistable_get(vis->table, loc, vis->cells);
+        if (count >= 0){
+            return count;
+        }
+    }
+    if (vis->cache != NULL){
+        return viscache_get(vis->cache, loc, vis->cells);
+    }
+    return visibility_compute(vis, loc, vis->cells);
+}
+
+
+/**************** visibility_getWidth ****************/
+/* Return the width of a map row, including its '\n'.
+ * See visibility.h for more information. */
+int visibility_getWidth(visibility_t* vis)
+{
+    return (vis == NULL) ? 0 : vis->width;
+}
+
+
+/**************** visibility_getLength ****************/
+/* Return the number of cells in the map.
+ * See visibility.h for more information. */
+int visibility_getLength(visibility_t* vis)
+{
+    return (vis == NULL) ? 0 : vis->length;
+}
+
+
+/**************** visibility_getBox ****************/
+/* Report the size of the box around loc that holds every visible cell.
+ * See visibility.h for more information. */
+void visibility_getBox(visibility_t* vis, int* boxWidth, int* boxHeight)
+{
+    if (vis == NULL || boxWidth == NULL || boxHeight == NULL){
+        return;
+    }
+    *boxWidth = vis->boxWidth;
+    *boxHeight = vis->boxHeight;
+}
+
+
+/**************** visibility_getTerrain ****************/
+/* Return the map char at index, gold shown as floor.
+ * See visibility.h for more information. */
+char visibility_getTerrain(visibility_t* vis, int index)
+{
+    return (vis == NULL) ? '\0' : terrainAt(vis, index);
+}
+
+
+/**************** visibility_buildTable ****************/
+/* Precompute every open cell into a compressed table.
+ * See visibility.h for more information. */
+bool visibility_buildTable(visibility_t* vis)
+{
+    // validate parameters
+    if (vis == NULL){
+        return false;
+    }
+    if (vis->table == NULL){
+        vis->table = vistable_new(vis);
+    }
+    return vis->table != NULL;
+}
+
+
+/**************** visibility_reportTable ****************/
+/* Print the size of the compressed table.
+ * See visibility.h for more information. */
+void visibility_reportTable(visibility_t* vis, FILE* fp)
+{
+    if (vis != NULL && vis->table != NULL){
+        vistable_report(vis->table, fp);
+    }
+}
+
+
+/**************** visibility_setStrategy ****************/
+/* Switch visibility_get to the given strategy.
+ * See visibility.h for more information. */
+bool visibility_setStrategy(visibility_t* vis, visStrategy_t strategy, int cacheSlots)
+{
+    // validate parameters
+    if (vis == NULL || strategy < 0 || strategy >= VIS_STRATEGY_COUNT){
+        return false;
+    }
+
+    // drop what the new strategy does not use (the thread goes first,
+    // since it computes with the current backend)
+    if (strategy != VIS_STRATEGY_CACHE){
+        viscache_delete(vis->cache);
+        vis->cache = NULL;
+    }
+    if (strategy != VIS_STRATEGY_TABLE){
+        vistable_delete(vis->table);
+        vis->table = NULL;
+    }
+    vis->backend = (strategy == VIS_STRATEGY_RAY) ? VIS_BACKEND_RAY : VIS_BACKEND_REGION;
+
+    if (strategy == VIS_STRATEGY_TABLE){
+        return visibility_buildTable(vis);
+    }
+    if (strategy == VIS_STRATEGY_CACHE){
+        return visibility_startSpeculation(vis, cacheSlots);
+    }
+    return true;
+}
+
+
+/**************** visibility_strategyName ****************/
+/* Return the name of a strategy.
+ * See visibility.h for more information. */
+const char* visibility_strategyName(visStrategy_t strategy)
+{
+    if (strategy < 0 || strategy >= VIS_STRATEGY_COUNT){
+        return "unknown";
+    }
+    return STRATEGY_NAMES[strategy];
+}
+
+
+/**************** visibility_parseStrategy ****************/
+/* Look up a strategy by name.
+ * See visibility.h for more information. */
+bool visibility_parseStrategy(const char* name, visStrategy_t* strategy)
+{
+    if (name == NULL || strategy == NULL){
+        return false;
+    }
+    for (int i = 0; i < VIS_STRATEGY_COUNT; i++){
+        if (strcmp(name, STRATEGY_NAMES[i]) == 0){
+            *strategy = i;
+            return true;
+        }
+    }
+
+    // the region backend's old name, for scripts that still use it
+    if (strcmp(name, "tile") == 0){
+        *strategy = VIS_STRATEGY_REGION;
+        return true;
+    }
+    return false;
+}
+
+
+/**************** visibility_startSpeculation ****************/
+/* Start the helper thread and its cache.
+ * See visibility.h for more information. */
+bool visibility_startSpeculation(visibility_t* vis, int slots)
+{
+    // validate parameters
+    if (vis == NULL || slots <= 0){
+        return false;
+    }
+    if (vis->cache == NULL){
+        vis->cache = viscache_new(vis, slots);
+    }
+    return vis->cache != NULL;
+}
+
+
+/**************** visibility_speculate ****************/
+/* Queue the cells reachable from loc for precomputation.
+ * See visibility.h for more information. */
+void visibility_speculate(visibility_t* vis, int loc)
+{
+    // nothing to do without a helper thread
+    if (vis == NULL || vis->cache == NULL || loc < 0 || loc >= vis->length){
+        return;
+    }
+
+    // y k u
+    // h @ l
+    // b j n
+    int w = vis->width;
+    int steps[8] = {-1, -1 - w, -w, 1 - w, 1, 1 + w, w, -1 + w};
+
+    // single steps first, since they are the most likely next move
+    int targets[16];
+    int n = 0;
+    for (int i = 0; i < 8; i++){
+        char next = terrainAt(vis, loc + steps[i]);
+        if (next == '.' || next == '#'){
+            targets[n++] = loc + steps[i];
+        }
+    }
+    for (int i = 0; i < 8; i++){
+        int end = sprintEnd(vis, loc, steps[i]);
+        if (end != loc){
+            targets[n++] = end;
+        }
+    }
+    viscache_request(vis->cache, targets, n);
+}
+
+
+/**************** visibility_report ****************/
+/* Print cache statistics.
+ * See visibility.h for more information. */
+void visibility_report(visibility_t* vis, FILE* fp)
+{
+    if (vis != NULL && vis->cache != NULL){
+        viscache_report(vis->cache, fp);
+    }
+}
+
+
+/**************** visibility_delete ****************/
+/* Stop any helper thread and free everything.
+ * See visibility.h for more information. */
+void visibility_delete(visibility_t* vis)
+{
+    // validate
+    if (vis == NULL){
+        return;
+    }
+    // the helper thread reads terrain, so stop it first
+    viscache_delete(vis->cache);
+    vistable_delete(vis->table);
+    free(vis->terrain);
+    free(vis->walls);
+    free(vis->cells);
+    free(vis->solid);
+    free(vis->region);
+    free(vis->regionWallStart);
+    free(vis->regionWalls);
+    visibility_deleteScratch(vis->scratch);
+    free(vis);
+}
+
+
+/**************** terrainAt ****************/
+/* Return the map char at index, or '\0' if index is off the map. */
+static char terrainAt(visibility_t* vis, int index)
+{
+    if (index < 0 || index >= vis->length){
+        return '\0';
+    }
+    return vis->terrain[index];
+}
+
+
+/**************** isObstruction ****************/
+/* Return true if c blocks sight: rock, wall, roof, corner, or passage. */
+static bool isObstruction(char c)
+{
+    return c == ' ' || c == '|' || c == '-' || c == '+' || c == '#';
+}
+
+
+/**************** inCorridor ****************/
+/* Return true if loc is in a corridor (passages on 2 sides, or on 1 side
+ * with rock on another). */
+static bool inCorridor(visibility_t* vis, int loc)
+{
+    // only count up, down, right, and left
+    int hashCount = 0;
+    int width = vis->width;
+
+    if (terrainAt(vis, loc + 1) == '#'){
+        hashCount++;
+    }
+    if (terrainAt(vis, loc - 1) == '#'){
+        hashCount++;
+    }
+    if ((loc + width) < vis->length && terrainAt(vis, loc + width) == '#'){
+        hashCount++;
+    }
+    if ((loc - width) < 0 && terrainAt(vis, loc - width) == '#'){
+        hashCount++;
+    }
+
+    if (hashCount > 1){
+        return true;
+    }
+    if (hashCount == 1){
+        // look if the corridor goes to nowhere
+        if (terrainAt(vis, loc + 1) == ' ' || terrainAt(vis, loc - 1) == ' '
+            || terrainAt(vis, loc + width) == ' ' || terrainAt(vis, loc - width) == ' '){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**************** visLimit ****************/
+/* Return true if endPoint is too far from startPoint to be seen. */
+static bool visLimit(visibility_t* vis, int startPoint, int endPoint)
+{
+    int width = vis->width;
+    int wDiff = abs((endPoint % width) - (startPoint % width));
+    double hDiff = round(abs((int)(((double)endPoint) / width)) - (((double)startPoint) / width));
+
+    // using pythagorean theorem
+    return (wDiff * wDiff) + (hDiff * hDiff) > vis->radius * vis->radius;
+}
+
+
+/**************** traceRay ****************/
+/* Walk the line from curPlayerLoc to curWall, writing every cell within
+ * the radius into ray. Return how many were written, or 0 if the line is
+ * blocked (both its ceiling and floor cells hit an obstruction).
+ *
+ * Walks both the ceiling and floor rounding of the line so that both
+ * sides of a diagonal can be seen. Gives up once it has walked past the
+ * wall, which can happen when rounding steps over it. */
+static int traceRay(visibility_t* vis, int curWall, int curPlayerLoc, int* ray, int rayCap)
+{
+    int width = vis->width;
+    int n = 0;
+
+    // + therefore player is left of wall, - therefore right of wall
+    int widthDifference = (curWall % width) - (curPlayerLoc % width);
+    // + therefore player is above wall, - therefore below wall
+    int heightDifference = (curWall / width) - (curPlayerLoc / width);
+
+    // check how many points in between (pythagorean theorem)
+    double pointsInBetween = sqrt((heightDifference * heightDifference) + (widthDifference * widthDifference));
+    int maxSteps = (int)ceil(pointsInBetween) + 3;
+
+    double exactHeightMove = (heightDifference / pointsInBetween) * width;
+    double exactWidthMove = widthDifference / pointsInBetween;
+    double curHMove = 0.0;
+    double curWMove = 0.0;
+    int startPoint = curPlayerLoc;
+
+    int roundedCeilCurPoint = curPlayerLoc;
+    int roundedFloorCurPoint = curPlayerLoc;
+    bool floorHit = false;
+    bool ceilHit = false;
+    bool wide = abs(heightDifference) < abs(widthDifference);
+
+    for (int step = 0; roundedCeilCurPoint != curWall && roundedFloorCurPoint != curWall; step++){
+        // walked past the wall without landing on it
+        if (step > maxSteps){
+            return 0;
+        }
+
+        // the starting point is never an obstruction
+        if (step > 0 && isObstruction(terrainAt(vis, roundedCeilCurPoint))){
+            if (floorHit){
+                return 0;
+            }
+            ceilHit = true;
+        }
+        if (step > 0 && isObstruction(terrainAt(vis, roundedFloorCurPoint))){
+            if (ceilHit){
+                return 0;
+            }
+            floorHit = true;
+        }
+
+        if (!ceilHit && n < rayCap && !visLimit(vis, startPoint, roundedCeilCurPoint)){
+            ray[n++] = roundedCeilCurPoint;
+        }
+        if (!floorHit && n < rayCap && !visLimit(vis, startPoint, roundedFloorCurPoint)){
+            ray[n++] = roundedFloorCurPoint;
+        }
+
+        curHMove += exactHeightMove;
+        curWMove += exactWidthMove;
+        if (wide){
+            // width greater than height, so floor and ceil the height
+            double exactCeilCurPoint = startPoint + curWMove + ceil(curHMove / width) * width;
+            double exactFloorCurPoint = startPoint + curWMove + floor(curHMove / width) * width;
+            roundedCeilCurPoint = (int)round(exactCeilCurPoint);
+            roundedFloorCurPoint = (int)round(exactFloorCurPoint);
+        }
+        else{
+            // else floor and ceil the width
+            double exactCurPoint = startPoint + curWMove + round(curHMove / width) * width;
+            roundedCeilCurPoint = (int)ceil(exactCurPoint);
+            roundedFloorCurPoint = (int)floor(exactCurPoint);
+        }
+    }
+
+    // need to add the wall too
+    if (n < rayCap && !visLimit(vis, startPoint, curWall)){
+        ray[n++] = curWall;
+    }
+    return n;
+}
+
+
+/**************** markCell ****************/
+/* Mark cell in the box around loc; return true if it was not marked
+ * before and is on the map. */
+static bool markCell(visibility_t* vis, unsigned char* box, int loc, int cell)
+{
+    int at = boxIndex(vis, loc, cell);
+    if (at < 0 || box[at]){
+        return false;
+    }
+    box[at] = 1;
+    return true;
+}
+
+
+/**************** boxIndex ****************/
+/* Return where cell is in the box around loc, or -1 if it is outside
+ * the box or off the map. */
+static int boxIndex(visibility_t* vis, int loc, int cell)
+{
+    if (cell < 0 || cell >= vis->length){
+        return -1;
+    }
+    int row = cell / vis->width - loc / vis->width + (vis->boxHeight / 2);
+    int col = cell % vis->width - loc % vis->width + (vis->boxWidth / 2);
+    if (row < 0 || row >= vis->boxHeight || col < 0 || col >= vis->boxWidth){
+        return -1;
+    }
+    return row * vis->boxWidth + col;
+}
+
+
+/**************** sprintEnd ****************/
+/* Return where a sprint from loc by step would stop: the last cell before
+ * a wall, rock, or the edge of the map. */
+static int sprintEnd(visibility_t* vis, int loc, int step)
+{
+    int end = loc;
+    char next = terrainAt(vis, end + step);
+    while (next == '.' || next == '#'){
+        end += step;
+        next = terrainAt(vis, end + step);
+    }
+    return end;
+}
+
+
+/**************** buildRegions ****************/
+/* Label the regions: the sets of cells that are not solid and connected
+ * 8 ways (like the rounded points of a ray), without crossing a '\n'.
+ * Then list, for each region, the walls within CULL_REACH (rows and
+ * columns) of any of its cells, in map order: the only walls whose rays
+ * can be unblocked from a cell of the region. Return false if out of
+ * memory. */
+static bool buildRegions(visibility_t* vis)
+{
+    int w = vis->width;
+    vis->solid = calloc(vis->length + 1, 1);
+    vis->region = calloc(vis->length + 1, sizeof(int));
+    int* queue = malloc((vis->length + 1) * sizeof(int));
+    if (vis->solid == NULL || vis->region == NULL || queue == NULL){
+        free(queue);
+        return false;
+    }
+
+    // solid means the whole 3x3 block blocks sight; '\n' and the edge of
+    // the map do not, so a block that wraps a row end is never solid
+    int around[9] = {0, -1, 1, -w, w, -w - 1, -w + 1, w - 1, w + 1};
+    for (int i = 0; i < vis->length; i++){
+        bool solid = true;
+        for (int k = 0; k < 9 && solid; k++){
+            solid = isObstruction(terrainAt(vis, i + around[k]));
+        }
+        vis->solid[i] = solid;
+    }
+
+    // flood fill each region in turn, numbering them from 1
+    int steps[8] = {-1, -1 - w, -w, 1 - w, 1, 1 + w, w, -1 + w};
+    for (int start = 0; start < vis->length; start++){
+        if (vis->solid[start] || vis->region[start] || vis->terrain[start] == '\n'){
+            continue;
+        }
+        int label = ++vis->regions;
+        int n = 0;
+        vis->region[start] = label;
+        queue[n++] = start;
+        for (int head = 0; head < n; head++){
+            for (int i = 0; i < 8; i++){
+                int next = queue[head] + steps[i];
+                // a ray's rounded points never centre on a '\n', so skip them
+                if (next >= 0 && next < vis->length && !vis->solid[next] && !vis->region[next]
+                    && vis->terrain[next] != '\n'){
+                    vis->region[next] = label;
+                    queue[n++] = next;
+                }
+            }
+        }
+    }
+    free(queue);
+
+    // count the near walls of each region, then place them (kept in map order)
+    vis->regionWallStart = calloc(vis->regions + 2, sizeof(int));
+    if (vis->regionWallStart == NULL){
+        return false;
+    }
+    int* found = malloc((2 * CULL_REACH + 1) * (2 * CULL_REACH + 1) * sizeof(int));
+    if (found == NULL){
+        return false;
+    }
+    int total = 0;
+    for (int i = 0; vis->walls[i] != -1; i++){
+        int n = nearRegions(vis, vis->walls[i], found);
+        for (int k = 0; k < n; k++){
+            vis->regionWallStart[found[k] + 1]++;
+        }
+        total += n;
+    }
+    for (int r = 0; r <= vis->regions; r++){
+        vis->regionWallStart[r + 1] += vis->regionWallStart[r];
+    }
+    vis->regionWalls = malloc((total + 1) * sizeof(int));
+    int* fill = malloc((vis->regions + 1) * sizeof(int));
+    if (vis->regionWalls == NULL || fill == NULL){
+        free(found);
+        free(fill);
+        return false;
+    }
+    memcpy(fill, vis->regionWallStart, (vis->regions + 1) * sizeof(int));
+    for (int i = 0; vis->walls[i] != -1; i++){
+        int n = nearRegions(vis, vis->walls[i], found);
+        for (int k = 0; k < n; k++){
+            vis->regionWalls[fill[found[k]]++] = vis->walls[i];
+        }
+    }
+    free(found);
+    free(fill);
+    return true;
+}
+
+
+/**************** nearRegions ****************/
+/* Write into found the regions with a cell within CULL_REACH rows and
+ * columns of wall, each once; return how many. */
+static int nearRegions(visibility_t* vis, int wall, int* found)
+{
+    int n = 0;
+    int row = wall / vis->width;
+    int col = wall % vis->width;
+    for (int r = row - CULL_REACH; r <= row + CULL_REACH; r++){
+        for (int c = col - CULL_REACH; c <= col + CULL_REACH; c++){
+            int cell = r * vis->width + c;
+            if (r < 0 || c < 0 || c >= vis->width || cell >= vis->length || vis->region[cell] == 0){
+                continue;
+            }
+            int k = 0;
+            while (k < n && found[k] != vis->region[cell]){
+                k++;
+            }
+            if (k == n){
+                found[n++] = vis->region[cell];
+            }
+        }
+    }
+    return n;
+}
+
+
+/**************** traceWall ****************/
+/* Trace the ray from loc to wall and append its new cells to cells.
+ * Return the new count. */
+static int traceWall(visibility_t* vis, visScratch_t* scratch, int wall, int loc, int* cells, int count)
+{
+    int rayLen = traceRay(vis, wall, loc, scratch->ray, scratch->rayCap);
+    for (int i = 0; i < rayLen; i++){
+        if (markCell(vis, scratch->box, loc, scratch->ray[i])){
+            cells[count++] = scratch->ray[i];
+        }
+    }
+    return count;
+}
+
+
+/**************** computeIn ****************/
+/* visibility_computeWith, with scratch's buffers; the box is left all 0
+ * again by clearing just the cells reported. */
+static int computeIn(visibility_t* vis, visScratch_t* scratch, visBackend_t backend, int loc, int* cells)
+{
+    // validate parameters
+    if (cells == NULL || loc < 0 || loc >= vis->length){
+        return 0;
+    }
+    int count = 0;
+
+    // in a corridor you can only see 1 in front of you
+    if (inCorridor(vis, loc)){
+        int around[4] = {loc + 1, loc - 1, loc + vis->width, loc - vis->width};
+        for (int i = 0; i < 4; i++){
+            if (around[i] >= 0 && around[i] < vis->length){
+                cells[count++] = around[i];
+            }
+        }
+        return count;
+    }
+
+    int r = vis->region[loc];
+    if (backend == VIS_BACKEND_REGION && r > 0){
+        // only walls near loc's region can have an unblocked ray
+        for (int w = vis->regionWallStart[r]; w < vis->regionWallStart[r + 1]; w++){
+            count = traceWall(vis, scratch, vis->regionWalls[w], loc, cells, count);
+        }
+    }
+    else{
+        // (a solid loc, such as a boxed-in passage, has no region)
+        // look at every wall, keeping the rays that are not blocked
+        for (int w = 0; vis->walls[w] != -1; w++){
+            count = traceWall(vis, scratch, vis->walls[w], loc, cells, count);
+        }
+    }
+
+    for (int i = 0; i < count; i++){
+        scratch->box[boxIndex(vis, loc, cells[i])] = 0;
+    }
+    return count;
+}
@@ -0,0 +1,236 @@
+/*
+ * visibility.h - header file for visibility module
+ *
+ * A visibility object answers "which cells can a player standing at
+ * index loc see?" for one map. The answer depends only on the map's
+ * walls and corridors (never on gold or players), so it can be computed
+ * ahead of time, cached, and shared between players.
+ *
+ * Cells are reported as indices into the map string, exactly like the
+ * indices used by the grid module.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#ifndef __VISIBILITY_H
+#define __VISIBILITY_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "grid.h"
+
+
+/**************** global types ****************/
+typedef struct visibility visibility_t;
+typedef struct visScratch visScratch_t;     // buffers for one computing thread
+
+// ways of computing a visible set; all give exactly the same cells
+typedef enum visBackend {
+    VIS_BACKEND_RAY,    // trace a ray to every wall of the map
+    VIS_BACKEND_REGION  // cull walls not near loc's region, then trace rays
+} visBackend_t;
+
+// what visibility_get is built on, see visibility_setStrategy
+typedef enum visStrategy {
+    VIS_STRATEGY_RAY,   // compute with VIS_BACKEND_RAY on every lookup
+    VIS_STRATEGY_REGION, // compute with VIS_BACKEND_REGION on every lookup
+    VIS_STRATEGY_TABLE, // look up a table of every open cell, built up front
+    VIS_STRATEGY_CACHE, // region lookups, cached and warmed by a helper thread
+    VIS_STRATEGY_COUNT
+} visStrategy_t;
+
+
+/**************** functions ****************/
+
+/**************** visibility_new ****************/
+/* Create a visibility object for the given map, where players see
+ * radius cells far (the original game uses 5).
+ *
+ * Notes:
+ *   the map is copied (with gold replaced by floor), so later changes
+ *     to the grid do not affect visibility
+ *   computes with VIS_BACKEND_REGION until visibility_setBackend
+ *   caller is responsible for calling visibility_delete
+ *
+ * validate grid and radius
+ * copy the map and record its width and length
+ * collect the indices of all walls, roofs, corners and passages
+ * mark the solid cells, label the regions, and list each region's walls
+ * return NULL on any error
+ */
+visibility_t* visibility_new(grid_t* entireMap, int radius);
+
+
+/**************** visibility_maxCells ****************/
+/* Return the most cells a single computation can report.
+ * Any cells buffer passed to visibility_compute must hold this many ints.
+ */
+int visibility_maxCells(visibility_t* vis);
+
+
+/**************** visibility_compute ****************/
+/* Compute the cells visible from loc into cells; return how many.
+ *
+ * Notes:
+ *   uses buffers kept in vis, so only one thread may call this at a
+ *     time; other threads use visibility_computeIn
+ *   each visible cell is reported exactly once, in no particular order
+ *
+ * if loc is in a corridor
+ *   only the 4 cells next to loc are visible
+ * otherwise
+ *   trace a ray from loc to every wall (that the backend did not cull)
+ *   keep the cells of each ray that is not blocked on both sides
+ *   drop cells farther than the visibility radius
+ */
+int visibility_compute(visibility_t* vis, int loc, int* cells);
+
+
+/**************** visibility_computeWith ****************/
+/* Like visibility_compute, but with the given backend.
+ *
+ * VIS_BACKEND_REGION only skips walls whose ray is certain to be blocked:
+ * a ray is blocked if it passes a "solid" cell (one whose 3x3
+ * neighbourhood is all obstruction), since both of its rounded paths
+ * land in that neighbourhood on the same step. So walls more than 4
+ * cells from everything reachable from loc without crossing a solid
+ * cell cannot be seen. What is reachable from where (a region) and the
+ * walls near each region are worked out once, by visibility_new, so a
+ * lookup only traces its region's walls.
+ */
+int visibility_computeWith(visibility_t* vis, visBackend_t backend, int loc, int* cells);
+
+
+/**************** visibility_newScratch ****************/
+/* Allocate the buffers a thread other than vis's owner needs to
+ * compute with visibility_computeIn. Return NULL on error.
+ * Caller is responsible for calling visibility_deleteScratch.
+ */
+visScratch_t* visibility_newScratch(visibility_t* vis);
+
+
+/**************** visibility_computeIn ****************/
+/* Like visibility_compute, but with scratch's buffers, so threads
+ * with their own scratch may compute at once.
+ */
+int visibility_computeIn(visibility_t* vis, visScratch_t* scratch, int loc, int* cells);
+
+
+/**************** visibility_deleteScratch ****************/
+/* Free buffers made by visibility_newScratch. */
+void visibility_deleteScratch(visScratch_t* scratch);
+
+
+/**************** visibility_setBackend ****************/
+/* Choose the backend visibility_compute uses from now on.
+ * Only call this while no helper thread is running.
+ */
+void visibility_setBackend(visibility_t* vis, visBackend_t backend);
+
+
+/**************** visibility_getRadius ****************/
+/* Return how many cells far players can see. */
+int visibility_getRadius(visibility_t* vis);
+
+
+/**************** visibility_getWidth ****************/
+/* Return the width of a map row, including its '\n'. */
+int visibility_getWidth(visibility_t* vis);
+
+
+/**************** visibility_getLength ****************/
+/* Return the number of cells (chars) in the map. */
+int visibility_getLength(visibility_t* vis);
+
+
+/**************** visibility_getBox ****************/
+/* Set *boxWidth and *boxHeight to the size of the box, centred on loc,
+ * that every cell visible from loc falls inside. maxCells is their product.
+ */
+void visibility_getBox(visibility_t* vis, int* boxWidth, int* boxHeight);
+
+
+/**************** visibility_getTerrain ****************/
+/* Return the map char at index with gold shown as floor, or '\0' if
+ * index is off the map. Players can stand on '.' and '#'.
+ */
+char visibility_getTerrain(visibility_t* vis, int index);
+
+
+/**************** visibility_get ****************/
+/* Return the number of cells visible from loc and point *cells at them.
+ *
+ * Notes:
+ *   *cells points into storage owned by vis and is only valid until the
+ *     next call to visibility_get; only the game thread may call this
+ *   uses the compressed table if one was built, otherwise the
+ *     speculation cache when it is running
+ */
+int visibility_get(visibility_t* vis, int loc, const int** cells);
+
+
+/**************** visibility_buildTable ****************/
+/* Precompute visibility for every open cell into a compressed table
+ * (see vistable.h), so visibility_get becomes a table lookup.
+ * Return false if the table cannot be built.
+ */
+bool visibility_buildTable(visibility_t* vis);
+
+
+/**************** visibility_reportTable ****************/
+/* Print the size of the compressed table to fp, if one was built. */
+void visibility_reportTable(visibility_t* vis, FILE* fp);
+
+
+/**************** visibility_setStrategy ****************/
+/* Switch visibility_get to the given strategy: pick the backend, build
+ * the table or start the helper thread (with cacheSlots slots) if the
+ * strategy needs one, and drop whichever it does not need.
+ * Return false if the table or thread cannot be had; vis then uses
+ * VIS_STRATEGY_REGION.
+ */
+bool visibility_setStrategy(visibility_t* vis, visStrategy_t strategy, int cacheSlots);
+
+
+/**************** visibility_strategyName ****************/
+/* Return the name of a strategy ("ray", "region", "table", "cache"). */
+const char* visibility_strategyName(visStrategy_t strategy);
+
+
+/**************** visibility_parseStrategy ****************/
+/* Set *strategy to the strategy called name ("tile" is taken for
+ * "region", its old name); return false if there is no such strategy.
+ */
+bool visibility_parseStrategy(const char* name, visStrategy_t* strategy);
+
+
+/**************** visibility_startSpeculation ****************/
+/* Start a helper thread that precomputes visibility for the cells a
+ * player can reach from their next move, keeping them in a cache of
+ * the given number of slots. Return false if the thread cannot start.
+ */
+bool visibility_startSpeculation(visibility_t* vis, int slots);
+
+
+/**************** visibility_speculate ****************/
+/* Tell the helper thread a player now stands at loc.
+ * It will warm the cache for the 8 neighbours of loc and the end of
+ * each of the 8 sprint lines from loc. Does nothing if speculation is
+ * not running.
+ */
+void visibility_speculate(visibility_t* vis, int loc);
+
+
+/**************** visibility_report ****************/
+/* Print cache hit rates and wasted precompute work to fp.
+ * Prints nothing if speculation is not running.
+ */
+void visibility_report(visibility_t* vis, FILE* fp);
+
+
+/**************** visibility_delete ****************/
+/* Stop any helper thread and free everything in vis. */
+void visibility_delete(visibility_t* vis);
+
+#endif // __VISIBILITY_H
@@ -0,0 +1,614 @@
+/*
+ * vistable.c - implementation file for the compressed visibility table
+ *
+ * Record format, one per open cell in map order:
+ *   varint  (nRuns << 2) | kind
+ *   kind RUNS, SAME or MOVED:
+ *     varint  run length x nRuns   -- alternating runs of 0s and 1s of
+ *                                     (mask XOR prediction), starting
+ *                                     with 0s; the trailing 0s are omitted
+ *   kind RAW:
+ *     the mask's bits, packed     -- nRuns is 0
+ * The prediction is nothing for RUNS, the previous record's mask for
+ * SAME, and the previous record's mask moved onto this cell's box (so
+ * each bit is the same map cell) for MOVED. The first record of a block
+ * is never predicted from the one before it.
+ * See vistable.h for more information.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "vistable.h"
+#include "visibility.h"
+
+/**************** file-local global variables ****************/
+static const int BLOCK_RECORDS = 32;    // records between block index entries
+static const char* KIND_NAMES[] = {"runs", "same", "moved", "raw"};
+
+/**************** local types ****************/
+// how a record is stored, see the top of this file
+typedef enum recordKind {
+    KIND_RUNS,
+    KIND_SAME,
+    KIND_MOVED,
+    KIND_RAW,
+    KIND_COUNT
+} recordKind_t;
+
+/**************** global types ****************/
+typedef struct vistable {
+    int length;             // cells in the map
+    int width;              // map row width, including '\n'
+    int boxWidth;           // mask geometry, see visibility_getBox
+    int boxHeight;
+    int maskBits;           // boxWidth * boxHeight
+    int rowBytes;           // bytes per mask row in memory
+    int maskBytes;          // rowBytes * boxHeight, an uncompressed mask in memory
+    int rawBytes;           // bytes of a RAW record's packed bits
+
+    int openCells;          // number of records
+    uint64_t* openBits;     // bit per map cell: is it open?
+    uint32_t* rankBase;     // open cells before each word of openBits
+
+    int blocks;
+    uint32_t* blockOffset;  // data offset of every BLOCK_RECORDS-th record
+    uint32_t* blockLoc;     // map index of that record
+    int kinds[KIND_COUNT];  // records of each kind
+
+    uint8_t* data;          // the records
+    size_t dataBytes;
+    size_t dataCap;
+} vistable_t;
+
+/**************** local functions ****************/
+static int rankOf(vistable_t* table, int loc);
+static int nextOpen(vistable_t* table, int loc);
+static void splitOffset(vistable_t* table, int offset, int* row, int* col);
+static int maskBit(vistable_t* table, int loc, int cell);
+static bool buildMasks(vistable_t* table, visibility_t* vis, uint8_t* masks);
+static void predict(vistable_t* table, recordKind_t kind, const uint8_t* prev, int prevLoc, int loc, uint8_t* out);
+static void moveRow(vistable_t* table, const uint8_t* src, int shift, uint8_t* dst);
+static int measureRuns(vistable_t* table, const uint8_t* mask, const uint8_t* guess, uint32_t* runs, size_t* bytes);
+static bool encodeRecords(vistable_t* table, const uint8_t* masks);
+static void decodeRecord(vistable_t* table, const uint8_t** p, const uint8_t* prev, int prevLoc, int loc, uint8_t* mask);
+static bool makeRoom(vistable_t* table, size_t bytes);
+static bool putByte(vistable_t* table, uint8_t byte);
+static bool putVarint(vistable_t* table, uint32_t value);
+static int varintBytes(uint32_t value);
+static uint32_t getVarint(const uint8_t** p);
+static inline bool getBit(const uint8_t* mask, int bit);
+static inline int bitAt(vistable_t* table, int row, int col);
+
+
+/**************** vistable_new ****************/
+/* Build a compressed table for every open cell of the map.
+ * See vistable.h for more information. */
+vistable_t* vistable_new(visibility_t* vis)
+{
+    // validate parameters
+    if (vis == NULL){
+        return NULL;
+    }
+
+    vistable_t* table = calloc(1, sizeof(vistable_t));
+    if (table == NULL){
+        fprintf(stderr, "Error: issue allocating memory in vistable_new\n");
+        return NULL;
+    }
+    table->length = visibility_getLength(vis);
+    table->width = visibility_getWidth(vis);
+    visibility_getBox(vis, &table->boxWidth, &table->boxHeight);
+    table->maskBits = table->boxWidth * table->boxHeight;
+    table->rowBytes = (table->boxWidth + 7) / 8;
+    table->maskBytes = table->rowBytes * table->boxHeight;
+    table->rawBytes = (table->maskBits + 7) / 8;
+
+    // mark open cells, and count them a word at a time for the rank index
+    int words = (table->length + 63) / 64;
+    table->openBits = calloc(words, sizeof(uint64_t));
+    table->rankBase = calloc(words, sizeof(uint32_t));
+    if (table->openBits == NULL || table->rankBase == NULL){
+        fprintf(stderr, "Error: issue allocating memory in vistable_new\n");
+        vistable_delete(table);
+        return NULL;
+    }
+    for (int i = 0; i < table->length; i++){
+        char c = visibility_getTerrain(vis, i);
+        if (c == '.' || c == '#'){
+            table->openBits[i / 64] |= (uint64_t)1 << (i % 64);
+        }
+    }
+    for (int w = 0; w < words; w++){
+        table->rankBase[w] = table->openCells;
+        table->openCells += __builtin_popcountll(table->openBits[w]);
+    }
+
+    // the uncompressed masks are only needed while building
+    uint8_t* masks = calloc((size_t)table->openCells + 1, table->maskBytes);
+    bool ok = masks != NULL && buildMasks(table, vis, masks) && encodeRecords(table, masks);
+    free(masks);
+
+    if (!ok){
+        fprintf(stderr, "Error: issue building table in vistable_new\n");
+        vistable_delete(table);
+        return NULL;
+    }
+    return table;
+}
+
+
+/**************** vistable_get ****************/
+/* Decode the cells visible from loc.
+ * See vistable.h for more information. */
+int vistable_get(vistable_t* table, int loc, int* cells)
+{
+    // validate parameters
+    if (table == NULL || cells == NULL || loc < 0 || loc >= table->length){
+        return -1;
+    }
+    int rank = rankOf(table, loc);
+    if (rank < 0){
+        return -1;
+    }
+
+    // jump to the block, then decode each record from the one before it
+    int block = rank / BLOCK_RECORDS;
+    const uint8_t* p = table->data + table->blockOffset[block];
+    uint8_t masks[2][table->maskBytes];
+    int at = table->blockLoc[block];
+    int prevLoc = at;
+    for (int r = block * BLOCK_RECORDS; r <= rank; r++){
+        if (r > block * BLOCK_RECORDS){
+            at = nextOpen(table, at);
+        }
+        decodeRecord(table, &p, masks[(r + 1) % 2], prevLoc, at, masks[r % 2]);
+        prevLoc = at;
+    }
+    const uint8_t* mask = masks[rank % 2];
+
+    // turn the set bits back into map indices
+    int count = 0;
+    for (int row = 0; row < table->boxHeight; row++){
+        for (int col = 0; col < table->boxWidth; col++){
+            if (getBit(mask, bitAt(table, row, col))){
+                cells[count++] = loc + (row - table->boxHeight / 2) * table->width
+                                 + col - table->boxWidth / 2;
+            }
+        }
+    }
+    return count;
+}
+
+
+/**************** vistable_bytes ****************/
+/* Return the bytes used by the table.
+ * See vistable.h for more information. */
+size_t vistable_bytes(vistable_t* table)
+{
+    if (table == NULL){
+        return 0;
+    }
+    int words = (table->length + 63) / 64;
+    return sizeof(vistable_t)
+        + words * (sizeof(uint64_t) + sizeof(uint32_t))
+        + (size_t)table->blocks * 2 * sizeof(uint32_t)
+        + table->dataBytes;
+}
+
+
+/**************** vistable_report ****************/
+/* Print table statistics.
+ * See vistable.h for more information. */
+void vistable_report(vistable_t* table, FILE* fp)
+{
+    if (table == NULL || fp == NULL){
+        return;
+    }
+    size_t bytes = vistable_bytes(table);
+    size_t raw = (size_t)table->openCells * table->rawBytes;
+    fprintf(fp, "visibility table: %d open cells, %zu bytes (%.2f per cell, %zu uncompressed); records:",
+            table->openCells, bytes, table->openCells ? (double)bytes / table->openCells : 0.0, raw);
+    for (int k = 0; k < KIND_COUNT; k++){
+        fprintf(fp, " %d %s", table->kinds[k], KIND_NAMES[k]);
+    }
+    fprintf(fp, "\n");
+}
+
+
+/**************** vistable_delete ****************/
+/* Free the table.
+ * See vistable.h for more information. */
+void vistable_delete(vistable_t* table)
+{
+    if (table == NULL){
+        return;
+    }
+    free(table->openBits);
+    free(table->rankBase);
+    free(table->blockOffset);
+    free(table->blockLoc);
+    free(table->data);
+    free(table);
+}
+
+
+/**************** rankOf ****************/
+/* Return the record number of loc, or -1 if loc is not open. */
+static int rankOf(vistable_t* table, int loc)
+{
+    uint64_t word = table->openBits[loc / 64];
+    uint64_t bit = (uint64_t)1 << (loc % 64);
+    if ((word & bit) == 0){
+        return -1;
+    }
+    return table->rankBase[loc / 64] + __builtin_popcountll(word & (bit - 1));
+}
+
+
+/**************** nextOpen ****************/
+/* Return the first open cell after loc; there must be one. */
+static int nextOpen(vistable_t* table, int loc)
+{
+    int w = (loc + 1) / 64;
+    uint64_t word = table->openBits[w] & (~(uint64_t)0 << ((loc + 1) % 64));
+    while (word == 0){
+        word = table->openBits[++w];
+    }
+    return w * 64 + __builtin_ctzll(word);
+}
+
+
+/**************** splitOffset ****************/
+/* Split a map offset into rows and columns. Rows are rounded so that
+ * the column is within half a row width, so a corridor neighbour that
+ * wraps around the end of a row still lands next to its cell. */
+static void splitOffset(vistable_t* table, int offset, int* row, int* col)
+{
+    int half = table->width / 2;
+    *row = (offset >= -half) ? (offset + half) / table->width
+                             : -((-offset - half + table->width - 1) / table->width);
+    *col = offset - *row * table->width;
+}
+
+
+/**************** maskBit ****************/
+/* Return the mask bit of cell as seen from loc, or -1 if it is outside
+ * the box. Rows and columns come from splitOffset rather than from map
+ * columns, and vistable_get puts them back the same way. */
+static int maskBit(vistable_t* table, int loc, int cell)
+{
+    int row, col;
+    splitOffset(table, cell - loc, &row, &col);
+    row += table->boxHeight / 2;
+    col += table->boxWidth / 2;
+    if (row < 0 || row >= table->boxHeight || col < 0 || col >= table->boxWidth){
+        return -1;
+    }
+    return bitAt(table, row, col);
+}
+
+
+/**************** buildMasks ****************/
+/* Compute the disc mask of every open cell, in record order. Return
+ * false if some visible cell does not fit the box (only on maps
+ * narrower than the box). */
+static bool buildMasks(vistable_t* table, visibility_t* vis, uint8_t* masks)
+{
+    int* cells = malloc(visibility_maxCells(vis) * sizeof(int));
+    if (cells == NULL){
+        return false;
+    }
+    int rank = 0;
+    for (int loc = 0; loc < table->length; loc++){
+        if (rankOf(table, loc) < 0){
+            continue;
+        }
+        uint8_t* mask = masks + (size_t)rank * table->maskBytes;
+        int count = visibility_compute(vis, loc, cells);
+        for (int i = 0; i < count; i++){
+            int b = maskBit(table, loc, cells[i]);
+            if (b < 0){
+                free(cells);
+                return false;
+            }
+            mask[b / 8] |= 1 << (b % 8);
+        }
+        rank++;
+    }
+    free(cells);
+    return true;
+}
+
+
+/**************** predict ****************/
+/* Write into out the prediction of loc's mask for a record of the given
+ * kind, from prev, the mask of the record before it at prevLoc. */
+static void predict(vistable_t* table, recordKind_t kind, const uint8_t* prev, int prevLoc, int loc, uint8_t* out)
+{
+    if (kind == KIND_SAME){
+        memcpy(out, prev, table->maskBytes);
+        return;
+    }
+    memset(out, 0, table->maskBytes);
+    if (kind != KIND_MOVED){
+        return;
+    }
+
+    // row r, column c of loc's box is row r + dr, column c + dc of prevLoc's
+    int dr, dc;
+    splitOffset(table, loc - prevLoc, &dr, &dc);
+    for (int row = 0; row < table->boxHeight; row++){
+        if (row + dr >= 0 && row + dr < table->boxHeight){
+            moveRow(table, prev + (row + dr) * table->rowBytes, dc, out + row * table->rowBytes);
+        }
+    }
+}
+
+
+/**************** moveRow ****************/
+/* Set bit c of the mask row dst to bit c + shift of src, or 0 if that
+ * is outside the row. */
+static void moveRow(vistable_t* table, const uint8_t* src, int shift, uint8_t* dst)
+{
+    int n = table->rowBytes;
+    int bytes = (shift >= 0) ? shift / 8 : -(-shift / 8);
+    int bits = (shift >= 0) ? shift % 8 : -shift % 8;
+    for (int i = 0; i < n; i++){
+        int j = i + bytes;
+        unsigned near = (j >= 0 && j < n) ? src[j] : 0;
+        unsigned far = 0;
+        if (shift >= 0){
+            far = (bits > 0 && j + 1 >= 0 && j + 1 < n) ? src[j + 1] : 0;
+            dst[i] = (near >> bits) | (far << (8 - bits));
+        }
+        else{
+            far = (bits > 0 && j - 1 >= 0 && j - 1 < n) ? src[j - 1] : 0;
+            dst[i] = (near << bits) | (far >> (8 - bits));
+        }
+    }
+    // bits moved past the end of the row are padding, which stays 0
+    if (table->boxWidth % 8 != 0){
+        dst[n - 1] &= (1 << (table->boxWidth % 8)) - 1;
+    }
+}
+
+
+/**************** measureRuns ****************/
+/* Write the runs of (mask XOR guess) in box order into runs, up to and
+ * including the last run of 1s, and add their encoded size to *bytes.
+ * Return how many runs. */
+static int measureRuns(vistable_t* table, const uint8_t* mask, const uint8_t* guess, uint32_t* runs, size_t* bytes)
+{
+    int nRuns = 0;
+    int lastOne = 0;        // runs up to and including the last 1-run
+    bool current = false;   // runs start with 0s
+    runs[0] = 0;
+    for (int row = 0; row < table->boxHeight; row++){
+        for (int col = 0; col < table->boxWidth; col++){
+            int b = bitAt(table, row, col);
+            if ((getBit(mask, b) != getBit(guess, b)) != current){
+                current = !current;
+                runs[++nRuns] = 0;
+            }
+            runs[nRuns]++;
+            if (current){
+                lastOne = nRuns + 1;
+            }
+        }
+    }
+    for (int i = 0; i < lastOne; i++){
+        *bytes += varintBytes(runs[i]);
+    }
+    return lastOne;
+}
+
+
+/**************** encodeRecords ****************/
+/* Write every record, each in whichever kind is smallest, and the block
+ * index. */
+static bool encodeRecords(vistable_t* table, const uint8_t* masks)
+{
+    table->blocks = (table->openCells + BLOCK_RECORDS - 1) / BLOCK_RECORDS;
+    table->blockOffset = malloc(((size_t)table->blocks + 1) * sizeof(uint32_t));
+    table->blockLoc = malloc(((size_t)table->blocks + 1) * sizeof(uint32_t));
+    uint32_t* runs = malloc((table->maskBits + 1) * sizeof(uint32_t));
+    uint32_t* bestRuns = malloc((table->maskBits + 1) * sizeof(uint32_t));
+    uint8_t* guess = malloc(table->maskBytes);
+    if (table->blockOffset == NULL || table->blockLoc == NULL || runs == NULL || bestRuns == NULL
+        || guess == NULL){
+        free(runs);
+        free(bestRuns);
+        free(guess);
+        return false;
+    }
+
+    bool ok = true;
+    int rank = 0;
+    int prevLoc = 0;
+    for (int loc = 0; ok && loc < table->length; loc++){
+        if (rankOf(table, loc) < 0){
+            continue;
+        }
+        const uint8_t* mask = masks + (size_t)rank * table->maskBytes;
+        const uint8_t* prev = (rank > 0) ? mask - table->maskBytes : mask;
+        bool first = rank % BLOCK_RECORDS == 0;
+        if (first){
+            table->blockOffset[rank / BLOCK_RECORDS] = table->dataBytes;
+            table->blockLoc[rank / BLOCK_RECORDS] = loc;
+        }
+
+        // raw, unless some prediction's runs come out smaller
+        recordKind_t best = KIND_RAW;
+        int bestCount = 0;
+        size_t bestBytes = 1 + table->rawBytes;
+        for (recordKind_t kind = KIND_RUNS; kind < KIND_RAW; kind++){
+            if (first && kind != KIND_RUNS){
+                break;
+            }
+            predict(table, kind, prev, prevLoc, loc, guess);
+            size_t bytes = 0;
+            int nRuns = measureRuns(table, mask, guess, runs, &bytes);
+            bytes += varintBytes((uint32_t)nRuns << 2);
+            if (bytes < bestBytes){
+                best = kind;
+                bestCount = nRuns;
+                bestBytes = bytes;
+                memcpy(bestRuns, runs, nRuns * sizeof(uint32_t));
+            }
+        }
+
+        ok = putVarint(table, ((uint32_t)bestCount << 2) | best);
+        for (int i = 0; ok && i < bestCount; i++){
+            ok = putVarint(table, bestRuns[i]);
+        }
+        for (int i = 0; ok && best == KIND_RAW && i < table->rawBytes; i++){
+            uint8_t byte = 0;
+            for (int b = 8 * i; b < 8 * i + 8 && b < table->maskBits; b++){
+                byte |= getBit(mask, bitAt(table, b / table->boxWidth, b % table->boxWidth)) << (b % 8);
+            }
+            ok = putByte(table, byte);
+        }
+        table->kinds[best]++;
+        prevLoc = loc;
+        rank++;
+    }
+    free(runs);
+    free(bestRuns);
+    free(guess);
+    return ok;
+}
+
+
+/**************** decodeRecord ****************/
+/* Decode the record at *p, for loc, into mask and advance *p past it.
+ * prev is the mask of the record before it, at prevLoc. */
+static void decodeRecord(vistable_t* table, const uint8_t** p, const uint8_t* prev, int prevLoc, int loc, uint8_t* mask)
+{
+    uint32_t header = getVarint(p);
+    recordKind_t kind = header & 3;
+    uint32_t nRuns = header >> 2;
+    if (kind == KIND_RAW){
+        memset(mask, 0, table->maskBytes);
+        for (int b = 0; b < table->maskBits; b++){
+            if (((*p)[b / 8] >> (b % 8)) & 1){
+                int bit = bitAt(table, b / table->boxWidth, b % table->boxWidth);
+                mask[bit / 8] |= 1 << (bit % 8);
+            }
+        }
+        *p += table->rawBytes;
+        return;
+    }
+
+    // start from the prediction and flip the 1-runs
+    predict(table, kind, prev, prevLoc, loc, mask);
+    int at = 0;
+    for (uint32_t i = 0; i < nRuns; i++){
+        int len = getVarint(p);
+        if (i % 2 == 1){
+            for (int b = at; b < at + len; b++){
+                int bit = bitAt(table, b / table->boxWidth, b % table->boxWidth);
+                mask[bit / 8] ^= 1 << (bit % 8);
+            }
+        }
+        at += len;
+    }
+}
+
+
+/**************** makeRoom ****************/
+/* Make sure the data has room for bytes more; return false if out of
+ * memory. */
+static bool makeRoom(vistable_t* table, size_t bytes)
+{
+    if (table->dataBytes + bytes > table->dataCap){
+        size_t cap = (table->dataCap == 0) ? 4096 : 2 * table->dataCap;
+        uint8_t* data = realloc(table->data, cap);
+        if (data == NULL){
+            return false;
+        }
+        table->data = data;
+        table->dataCap = cap;
+    }
+    return true;
+}
+
+
+/**************** putByte ****************/
+/* Append one byte. */
+static bool putByte(vistable_t* table, uint8_t byte)
+{
+    if (!makeRoom(table, 1)){
+        return false;
+    }
+    table->data[table->dataBytes++] = byte;
+    return true;
+}
+
+
+/**************** putVarint ****************/
+/* Append value, 7 bits per byte, low bits first. */
+static bool putVarint(vistable_t* table, uint32_t value)
+{
+    // at most 5 bytes for 32 bits
+    if (!makeRoom(table, 5)){
+        return false;
+    }
+    while (value >= 0x80){
+        table->data[table->dataBytes++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    table->data[table->dataBytes++] = value;
+    return true;
+}
+
+
+/**************** varintBytes ****************/
+/* Return how many bytes putVarint takes for value. */
+static int varintBytes(uint32_t value)
+{
+    int bytes = 1;
+    while (value >= 0x80){
+        value >>= 7;
+        bytes++;
+    }
+    return bytes;
+}
+
+
+/**************** getVarint ****************/
+/* Read a value written by putVarint and advance *p past it. */
+static uint32_t getVarint(const uint8_t** p)
+{
+    uint32_t value = 0;
+    int shift = 0;
+    while (**p & 0x80){
+        value |= (uint32_t)(**p & 0x7f) << shift;
+        shift += 7;
+        (*p)++;
+    }
+    value |= (uint32_t)**p << shift;
+    (*p)++;
+    return value;
+}
+
+
+/**************** getBit ****************/
+static inline bool getBit(const uint8_t* mask, int bit)
+{
+    return (mask[bit / 8] >> (bit % 8)) & 1;
+}
+
+
+/**************** bitAt ****************/
+/* Return the bit of row, col in a mask in memory, where each row starts
+ * on a byte so whole rows can be moved. */
+static inline int bitAt(vistable_t* table, int row, int col)
+{
+    return row * table->rowBytes * 8 + col;
+}
@@ -0,0 +1,78 @@
+/*
+ * vistable.h - header file for the compressed visibility table module
+ *
+ * A vistable holds the visible set of every open cell of a map in a few
+ * bytes per cell. Each visible set is stored as a "disc mask": one bit
+ * per cell of the box around the player (see visibility_getBox).
+ * Neighbouring cells have nearly the same mask, so each cell keeps
+ * whichever is smallest of:
+ *
+ *   - its mask, run-length encoded as varints;
+ *   - the XOR of its mask with the previous cell's, run-length encoded,
+ *     either as is (the same disc in the middle of a room) or with the
+ *     previous mask moved onto this cell's box (the same walls);
+ *   - the raw bits, so no cell costs more than one byte over its mask.
+ *
+ * Cells are found in O(1): a rank bitmap turns a map index into the
+ * cell's position among open cells, and a block index points at every
+ * 32nd record, which is never encoded against the one before it, so a
+ * lookup decodes at most 32 records.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#ifndef __VISTABLE_H
+#define __VISTABLE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "visibility.h"
+
+
+/**************** global types ****************/
+typedef struct vistable vistable_t;
+
+
+/**************** functions ****************/
+
+/**************** vistable_new ****************/
+/* Build a table for every open cell of the map, computing each visible
+ * set with visibility_compute.
+ *
+ * Notes:
+ *   needs temporary memory for the uncompressed masks while building
+ *   returns NULL on any error
+ *   caller is responsible for calling vistable_delete
+ *
+ * mark open cells and build the rank index
+ * compute the mask of every open cell
+ * encode each cell in whichever form is smallest
+ */
+vistable_t* vistable_new(visibility_t* vis);
+
+
+/**************** vistable_get ****************/
+/* Decode the cells visible from loc into cells and return how many.
+ * Return -1 if loc is not an open cell (the caller should compute it).
+ * cells must hold visibility_maxCells(vis) ints.
+ */
+int vistable_get(vistable_t* table, int loc, int* cells);
+
+
+/**************** vistable_bytes ****************/
+/* Return the number of bytes the table occupies, index included. */
+size_t vistable_bytes(vistable_t* table);
+
+
+/**************** vistable_report ****************/
+/* Print the number of cells, the table size, and how many records
+ * are of each kind to fp. */
+void vistable_report(vistable_t* table, FILE* fp);
+
+
+/**************** vistable_delete ****************/
+/* Free the table. */
+void vistable_delete(vistable_t* table);
+
+#endif // __VISTABLE_H
@@ -0,0 +1,312 @@
+/* Nate Abbott
+ * CS50 Nuggets
+ *
+ * vistest.c - test file for the compressed visibility table
+ *
+ * For each map and a few radii, checks that both visibility backends
+ * agree on every open cell, that every open cell decodes from the table
+ * to exactly the cells visibility_compute reports, and prints table
+ * sizes and backend timings. Run from the top of the repo, like gridtest.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "grid.h"
+#include "visibility.h"
+#include "vistable.h"
+
+static const char* maps[] = {
+    "maps/main.txt", "maps/small.txt", "maps/hole.txt", "maps/narrow.txt",
+    "maps/big.txt", "maps/challenge.txt", "maps/edges.txt", "maps/fewspots.txt",
+    NULL
+};
+static const int radii[] = {5, 9, 0};
+static const int SYNTHETIC_SIZE = 256;     // rows and columns of the generated map
+static const int SYNTHETIC_SAMPLE = 61;    // check every this many open cells of it
+
+bool test_map(const char* mapFile, int radius);
+bool test_synthetic(int size, int radius);
+char* makeRooms(int size);
+void roomIn(int i, int j, int box[4]);
+bool test_backends(visibility_t *vis);
+bool sameCells(const int* a, int countA, const int* b, int countB, int length);
+
+/**************** main ****************/
+/* Usage: ./vistest [size], where size is the side of the generated map
+ * (default 256). */
+int main(int argc, char* argv[]){
+    printf("===== VISTABLE MODULE TESTS =====\n\n");
+
+    int failed = 0;
+    for (int i = 0; maps[i] != NULL; i++){
+        for (int r = 0; radii[r] != 0; r++){
+            if (!test_map(maps[i], radii[r])){
+                failed++;
+            }
+        }
+    }
+    int size = (argc > 1) ? atoi(argv[1]) : SYNTHETIC_SIZE;
+    for (int r = 0; radii[r] != 0; r++){
+        if (!test_synthetic(size, radii[r])){
+            failed++;
+        }
+    }
+    printf("\n%d test(s) failed\n", failed);
+    return failed == 0 ? 0 : 1;
+}
+
+
+/**************** test_map ****************/
+bool test_map(const char* mapFile, int radius) {
+    printf("--- %s, radius %d ---\n", mapFile, radius);
+    FILE *fp = fopen(mapFile, "r");
+    if (!fp) {
+        printf("Could not open file, skipping.\n");
+        return false;
+    }
+    grid_t *grid = grid_fromFile(fp);
+    fclose(fp);
+    visibility_t *vis = (grid == NULL) ? NULL : visibility_new(grid, radius);
+    if (vis == NULL) {
+        printf("Failed to load map.\n");
+        grid_delete(grid);
+        return false;
+    }
+
+    bool backendsAgree = test_backends(vis);
+
+    vistable_t *table = vistable_new(vis);
+    if (table == NULL) {
+        printf("Failed to build table.\n");
+        visibility_delete(vis);
+        grid_delete(grid);
+        return false;
+    }
+    vistable_report(table, stdout);
+
+    // every open cell must decode to the computed set; others are not stored
+    int maxCells = visibility_maxCells(vis);
+    int length = visibility_getLength(vis);
+    int *expected = malloc(maxCells * sizeof(int));
+    int *actual = malloc(maxCells * sizeof(int));
+    int checked = 0;
+    int mismatches = 0;
+    for (int loc = 0; loc < length; loc++) {
+        char c = visibility_getTerrain(vis, loc);
+        int count = vistable_get(table, loc, actual);
+        if (c != '.' && c != '#') {
+            if (count != -1) {
+                printf("Closed cell %d decoded to %d cells\n", loc, count);
+                mismatches++;
+            }
+            continue;
+        }
+        int want = visibility_compute(vis, loc, expected);
+        checked++;
+        if (!sameCells(expected, want, actual, count, length)) {
+            if (mismatches < 5) {
+                printf("Cell %d: computed %d cells, decoded %d\n", loc, want, count);
+            }
+            mismatches++;
+        }
+    }
+    printf("Checked %d open cells: %s\n\n", checked, mismatches == 0 ? "all match" : "MISMATCH");
+
+    free(expected);
+    free(actual);
+    vistable_delete(table);
+    visibility_delete(vis);
+    grid_delete(grid);
+    return backendsAgree && mismatches == 0;
+}
+
+
+/**************** test_synthetic ****************/
+/* Build a table for a generated size x size map of rooms, far bigger
+ * than the shipped maps, and report its size and build time. Too big to
+ * check every cell, so a sample is checked against visibility_compute. */
+bool test_synthetic(int size, int radius) {
+    printf("--- generated %dx%d rooms, radius %d ---\n", size, size, radius);
+    char *map = makeRooms(size);
+    grid_t *grid = (map == NULL) ? NULL : grid_new(map);
+    free(map);
+    visibility_t *vis = (grid == NULL) ? NULL : visibility_new(grid, radius);
+    if (vis == NULL) {
+        printf("Failed to make map.\n");
+        grid_delete(grid);
+        return false;
+    }
+
+    clock_t start = clock();
+    vistable_t *table = vistable_new(vis);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (table == NULL) {
+        printf("Failed to build table.\n");
+        visibility_delete(vis);
+        grid_delete(grid);
+        return false;
+    }
+    vistable_report(table, stdout);
+    printf("Built in %.2fs\n", seconds);
+
+    int maxCells = visibility_maxCells(vis);
+    int length = visibility_getLength(vis);
+    int *expected = malloc(maxCells * sizeof(int));
+    int *actual = malloc(maxCells * sizeof(int));
+    int open = 0;
+    int checked = 0;
+    int mismatches = 0;
+    double lookup = 0.0;
+    for (int loc = 0; loc < length; loc++) {
+        char c = visibility_getTerrain(vis, loc);
+        if ((c != '.' && c != '#') || open++ % SYNTHETIC_SAMPLE != 0) {
+            continue;
+        }
+        start = clock();
+        int count = vistable_get(table, loc, actual);
+        lookup += (double)(clock() - start) / CLOCKS_PER_SEC;
+        int want = visibility_compute(vis, loc, expected);
+        checked++;
+        if (!sameCells(expected, want, actual, count, length)) {
+            if (mismatches < 5) {
+                printf("Cell %d: computed %d cells, decoded %d\n", loc, want, count);
+            }
+            mismatches++;
+        }
+    }
+    printf("Checked %d of %d open cells (%.2f us a lookup): %s\n\n", checked, open,
+           checked ? 1e6 * lookup / checked : 0.0, mismatches == 0 ? "all match" : "MISMATCH");
+
+    free(expected);
+    free(actual);
+    vistable_delete(table);
+    visibility_delete(vis);
+    grid_delete(grid);
+    return mismatches == 0;
+}
+
+
+/**************** makeRooms ****************/
+/* Return a size x size map (caller frees) tiled with rooms of a few
+ * shapes, each joined to the rooms right of and below it by passages
+ * through their walls. */
+char* makeRooms(int size) {
+    int width = size + 1;
+    char *map = malloc((size_t)width * size + 1);
+    if (map == NULL) {
+        return NULL;
+    }
+    memset(map, ' ', (size_t)width * size);
+    for (int row = 0; row < size; row++) {
+        map[row * width + size] = '\n';
+    }
+    map[(size_t)width * size] = '\0';
+
+    // a room in each 32x16 chunk, within columns 2 to 29 and rows 1 to 14
+    int across = size / 32;
+    int down = size / 16;
+    for (int i = 0; i < down; i++) {
+        for (int j = 0; j < across; j++) {
+            int box[4];
+            roomIn(i, j, box);
+            for (int row = box[1]; row <= box[3]; row++) {
+                for (int col = box[0]; col <= box[2]; col++) {
+                    bool edgeRow = row == box[1] || row == box[3];
+                    bool edgeCol = col == box[0] || col == box[2];
+                    map[row * width + col] = (edgeRow && edgeCol) ? '+' : edgeRow ? '-' : edgeCol ? '|' : '.';
+                }
+            }
+        }
+    }
+
+    // row 8 and column 16 of every chunk cross every room's walls
+    for (int i = 0; i < down; i++) {
+        for (int j = 0; j < across; j++) {
+            int box[4], next[4];
+            roomIn(i, j, box);
+            if (j + 1 < across) {
+                roomIn(i, j + 1, next);
+                for (int col = box[2]; col <= next[0]; col++) {
+                    map[(i * 16 + 8) * width + col] = '#';
+                }
+            }
+            if (i + 1 < down) {
+                roomIn(i + 1, j, next);
+                for (int row = box[3]; row <= next[1]; row++) {
+                    map[row * width + j * 32 + 16] = '#';
+                }
+            }
+        }
+    }
+    return map;
+}
+
+
+/**************** roomIn ****************/
+/* Fill box with the left, top, right and bottom of the room in chunk
+ * row i, column j of makeRooms. */
+void roomIn(int i, int j, int box[4]) {
+    box[0] = j * 32 + 2 + (i * 5 + j * 3) % 4;
+    box[1] = i * 16 + 1 + (i + j) % 3;
+    box[2] = box[0] + 17 + (i * 7 + j * 11) % 8;
+    box[3] = box[1] + 8 + (i * 3 + j * 5) % 4;
+}
+
+
+/**************** test_backends ****************/
+/* Check the region backend against the ray backend on every open cell,
+ * timing both. */
+bool test_backends(visibility_t *vis) {
+    int maxCells = visibility_maxCells(vis);
+    int length = visibility_getLength(vis);
+    int *ray = malloc(maxCells * sizeof(int));
+    int *region = malloc(maxCells * sizeof(int));
+    double seconds[2] = {0.0, 0.0};
+    int mismatches = 0;
+
+    for (int loc = 0; loc < length; loc++) {
+        char c = visibility_getTerrain(vis, loc);
+        if (c != '.' && c != '#') {
+            continue;
+        }
+        clock_t start = clock();
+        int rayCount = visibility_computeWith(vis, VIS_BACKEND_RAY, loc, ray);
+        clock_t middle = clock();
+        int regionCount = visibility_computeWith(vis, VIS_BACKEND_REGION, loc, region);
+        seconds[0] += (double)(middle - start) / CLOCKS_PER_SEC;
+        seconds[1] += (double)(clock() - middle) / CLOCKS_PER_SEC;
+        if (!sameCells(ray, rayCount, region, regionCount, length)) {
+            if (mismatches < 5) {
+                printf("Cell %d: ray backend %d cells, region backend %d\n", loc, rayCount, regionCount);
+            }
+            mismatches++;
+        }
+    }
+    printf("Backends: ray %.3fs, region %.3fs: %s\n", seconds[0], seconds[1],
+           mismatches == 0 ? "all match" : "MISMATCH");
+    free(ray);
+    free(region);
+    return mismatches == 0;
+}
+
+
+/**************** sameCells ****************/
+/* Return true if a and b hold the same set of map indices. */
+bool sameCells(const int* a, int countA, const int* b, int countB, int length) {
+    if (countA != countB) {
+        return false;
+    }
+    char *seen = calloc(length, 1);
+    for (int i = 0; i < countA; i++) {
+        seen[a[i]] = 1;
+    }
+    bool same = true;
+    for (int i = 0; i < countB && same; i++) {
+        same = b[i] >= 0 && b[i] < length && seen[b[i]] == 1;
+    }
+    free(seen);
+    return same;
+}
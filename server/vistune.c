@@ -0,0 +1,298 @@
+/*
+ * vistune.c - implementation file for the visibility auto-tuner
+ *
+ * Every strategy is timed through visibility_get on the same walk, the
+ * way the server calls it: a lookup for the cell a player moved to,
+ * then visibility_speculate for that cell. Only the lookups are timed.
+ * See vistune.h for more information.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "vistune.h"
+#include "visibility.h"
+#include "rng.h"
+
+/**************** file-local global variables ****************/
+static const int SAMPLE_CELLS = 64;                 // length of the walk
+static const uint64_t WALK_SEED = 0x9e3779b97f4a7c15ULL;
+
+/**************** local types ****************/
+typedef struct sample {
+    int n;          // cells in the walk
+    int* locs;      // the walk
+    int maxCells;
+    int* counts;    // reference count for each cell
+    int* cells;     // reference cells for each cell, sorted, maxCells apart
+    int* scratch;   // room to sort a result
+} sample_t;
+
+/**************** local functions ****************/
+static double now(void);
+static int walk(visibility_t* vis, int* locs, int n, int* openCells);
+static bool isOpen(visibility_t* vis, int index);
+static int compareInts(const void* a, const void* b);
+static bool conforms(sample_t* sample, int i, const int* cells, int count);
+static void freeSample(sample_t* sample);
+
+
+/**************** vistune_choose ****************/
+/* Benchmark every strategy and keep the fastest one that conforms.
+ * See vistune.h for more information. */
+visStrategy_t vistune_choose(visibility_t* vis, int cacheSlots, double budget, FILE* fp)
+{
+    // validate parameters
+    if (vis == NULL){
+        return VIS_STRATEGY_REGION;
+    }
+
+    // everything from here on, table build included, comes out of the budget
+    double deadline = now() + budget;
+    double share = budget / VIS_STRATEGY_COUNT;
+
+    sample_t sample;
+    sample.maxCells = visibility_maxCells(vis);
+    sample.locs = malloc(SAMPLE_CELLS * sizeof(int));
+    sample.counts = malloc(SAMPLE_CELLS * sizeof(int));
+    sample.cells = malloc((size_t)SAMPLE_CELLS * sample.maxCells * sizeof(int));
+    sample.scratch = malloc(sample.maxCells * sizeof(int));
+    int openCells = 0;
+    sample.n = 0;
+    if (sample.locs != NULL && sample.counts != NULL && sample.cells != NULL && sample.scratch != NULL){
+        sample.n = walk(vis, sample.locs, SAMPLE_CELLS, &openCells);
+    }
+    if (sample.n == 0){
+        if (fp != NULL){
+            fprintf(fp, "visibility tune: nothing to measure, using region\n");
+        }
+        freeSample(&sample);
+        visibility_setStrategy(vis, VIS_STRATEGY_REGION, cacheSlots);
+        return VIS_STRATEGY_REGION;
+    }
+
+    // the reference, which also times the ray backend; later strategies
+    // are measured on however much of the walk it got through
+    double perLookup[VIS_STRATEGY_COUNT];
+    bool passed[VIS_STRATEGY_COUNT] = {false};
+    double elapsed = 0.0;
+    for (int i = 0; i < sample.n; i++){
+        int* ref = sample.cells + (size_t)i * sample.maxCells;
+        double start = now();
+        sample.counts[i] = visibility_computeWith(vis, VIS_BACKEND_RAY, sample.locs[i], ref);
+        elapsed += now() - start;
+        qsort(ref, sample.counts[i], sizeof(int), compareInts);
+        if (elapsed > share){
+            sample.n = i + 1;
+        }
+    }
+    perLookup[VIS_STRATEGY_RAY] = elapsed / sample.n;
+    passed[VIS_STRATEGY_RAY] = true;
+    if (fp != NULL){
+        fprintf(fp, "visibility tune: %-6s %10.1f us per lookup over %d cells (reference)\n",
+                "ray", 1e6 * perLookup[VIS_STRATEGY_RAY], sample.n);
+    }
+
+    // the table goes last, so if it wins it does not have to be rebuilt
+    visStrategy_t order[] = {VIS_STRATEGY_REGION, VIS_STRATEGY_CACHE, VIS_STRATEGY_TABLE};
+    visStrategy_t current = VIS_STRATEGY_REGION;
+    double tableBuild = 0.0;
+    for (int k = 0; k < 3; k++){
+        visStrategy_t strategy = order[k];
+        const char* name = visibility_strategyName(strategy);
+
+        double left = deadline - now();
+        if (left <= 0){
+            if (fp != NULL){
+                fprintf(fp, "visibility tune: %-6s skipped, out of time\n", name);
+            }
+            continue;
+        }
+
+        // building the table computes every open cell once
+        if (strategy == VIS_STRATEGY_TABLE){
+            double fastest = passed[VIS_STRATEGY_REGION] ? perLookup[VIS_STRATEGY_REGION] : perLookup[VIS_STRATEGY_RAY];
+            double estimate = fastest * openCells;
+            if (estimate > left){
+                if (fp != NULL){
+                    fprintf(fp, "visibility tune: %-6s skipped, building it would take about %.2f s of %.2f s left\n",
+                            name, estimate, left);
+                }
+                continue;
+            }
+        }
+
+        double start = now();
+        bool ready = visibility_setStrategy(vis, strategy, cacheSlots);
+        current = ready ? strategy : VIS_STRATEGY_REGION;
+        if (strategy == VIS_STRATEGY_TABLE){
+            tableBuild = now() - start;
+        }
+        if (!ready){
+            if (fp != NULL){
+                fprintf(fp, "visibility tune: %-6s skipped, could not be set up\n", name);
+            }
+            continue;
+        }
+
+        // time the lookups, then check them against the reference, until
+        // the share or the whole budget runs out (at least one lookup)
+        elapsed = 0.0;
+        int measured = 0;
+        int failedAt = -1;
+        for (int i = 0; i < sample.n && elapsed <= share && (i == 0 || now() < deadline); i++){
+            const int* cells;
+            double lookupStart = now();
+            int count = visibility_get(vis, sample.locs[i], &cells);
+            elapsed += now() - lookupStart;
+            measured++;
+            if (failedAt < 0 && !conforms(&sample, i, cells, count)){
+                failedAt = sample.locs[i];
+            }
+            visibility_speculate(vis, sample.locs[i]);
+        }
+        perLookup[strategy] = elapsed / measured;
+        passed[strategy] = failedAt < 0;
+
+        if (fp == NULL){
+            continue;
+        }
+        if (failedAt >= 0){
+            fprintf(fp, "visibility tune: %-6s rejected, differs from the reference at cell %d\n", name, failedAt);
+        }
+        else{
+            fprintf(fp, "visibility tune: %-6s %10.1f us per lookup over %d cells\n",
+                    name, 1e6 * perLookup[strategy], measured);
+        }
+    }
+    freeSample(&sample);
+
+    // ties go to the simpler strategy
+    visStrategy_t best = VIS_STRATEGY_RAY;
+    for (int s = 0; s < VIS_STRATEGY_COUNT; s++){
+        if (passed[s] && perLookup[s] < perLookup[best]){
+            best = s;
+        }
+    }
+    if (best != current && !visibility_setStrategy(vis, best, cacheSlots)){
+        best = VIS_STRATEGY_REGION;
+    }
+
+    if (fp != NULL){
+        fprintf(fp, "visibility tune: chose %s, the fastest strategy that matches the reference", visibility_strategyName(best));
+        if (best != VIS_STRATEGY_RAY && perLookup[best] > 0){
+            fprintf(fp, " (%.1fx faster than ray)", perLookup[VIS_STRATEGY_RAY] / perLookup[best]);
+        }
+        if (best == VIS_STRATEGY_TABLE){
+            fprintf(fp, ", built in %.2f s", tableBuild);
+        }
+        fprintf(fp, "\n");
+    }
+    return best;
+}
+
+
+/**************** now ****************/
+/* Return wall clock seconds; the cache's helper thread must not count. */
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/**************** walk ****************/
+/* Fill locs with a random walk of up to n open cells, stepping to a
+ * random open neighbour (or jumping anywhere when stuck). Set
+ * *openCells to the number of open cells on the map and return the
+ * number of cells walked. */
+static int walk(visibility_t* vis, int* locs, int n, int* openCells)
+{
+    int length = visibility_getLength(vis);
+    int width = visibility_getWidth(vis);
+    *openCells = 0;
+    for (int i = 0; i < length; i++){
+        *openCells += isOpen(vis, i);
+    }
+    if (*openCells == 0){
+        return 0;
+    }
+
+    rng_t* rng = rng_new(WALK_SEED);
+    if (rng == NULL){
+        return 0;
+    }
+    int steps[8] = {-1, -1 - width, -width, 1 - width, 1, 1 + width, width, -1 + width};
+    int loc = -1;
+    for (int i = 0; i < n; i++){
+        int next[8];
+        int choices = 0;
+        for (int k = 0; loc >= 0 && k < 8; k++){
+            if (isOpen(vis, loc + steps[k])){
+                next[choices++] = loc + steps[k];
+            }
+        }
+        if (choices > 0){
+            loc = next[rng_below(rng, choices)];
+        }
+        else{
+            // jump to a random open cell
+            int skip = rng_below(rng, *openCells);
+            for (loc = 0; !isOpen(vis, loc) || skip-- > 0; loc++){
+            }
+        }
+        locs[i] = loc;
+    }
+    rng_delete(rng);
+    return n;
+}
+
+
+/**************** isOpen ****************/
+/* Return true if a player can stand at index. */
+static bool isOpen(visibility_t* vis, int index)
+{
+    char c = visibility_getTerrain(vis, index);
+    return c == '.' || c == '#';
+}
+
+
+/**************** compareInts ****************/
+static int compareInts(const void* a, const void* b)
+{
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+
+/**************** conforms ****************/
+/* Return true if cells holds exactly the reference cells of walk step i. */
+static bool conforms(sample_t* sample, int i, const int* cells, int count)
+{
+    if (count != sample->counts[i]){
+        return false;
+    }
+    memcpy(sample->scratch, cells, count * sizeof(int));
+    qsort(sample->scratch, count, sizeof(int), compareInts);
+    return memcmp(sample->scratch, sample->cells + (size_t)i * sample->maxCells, count * sizeof(int)) == 0;
+}
+
+
+/**************** freeSample ****************/
+static void freeSample(sample_t* sample)
+{
+    free(sample->locs);
+    free(sample->counts);
+    free(sample->cells);
+    free(sample->scratch);
+}
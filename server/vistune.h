@@ -0,0 +1,46 @@
+/*
+ * vistune.h - header file for the visibility auto-tuner
+ *
+ * Which visibility strategy is fastest depends on the map: big open
+ * rooms, long corridors and scattered pillars all favour different
+ * ones. The tuner times every strategy on the same short random walk
+ * over the map at startup, checks each against the ray backend (the
+ * reference), and keeps the fastest one that agrees on every cell.
+ *
+ * Nate Abbott
+ * CS 50 Nuggets
+*/
+
+#ifndef __VISTUNE_H
+#define __VISTUNE_H
+
+#include <stdio.h>
+#include "visibility.h"
+
+
+/**************** functions ****************/
+
+/**************** vistune_choose ****************/
+/* Benchmark every strategy on vis, switch vis to the fastest one that
+ * passes the conformance check, and return it. One line per strategy
+ * and the reason for the choice are printed to fp.
+ *
+ * Notes:
+ *   takes about budget seconds in all, setup and table build included:
+ *     each strategy stops timing once it has used its share or the
+ *     budget is spent, strategies left when it is spent are skipped, and
+ *     the table is skipped if building it would not fit in what is left
+ *   walks with its own rng, so the game's random numbers are unchanged
+ *   cacheSlots is passed to visibility_setStrategy for the cache
+ *   falls back to VIS_STRATEGY_REGION if nothing else can be measured
+ *
+ * pick sample cells by a random walk between neighbouring open cells
+ * compute the reference for each with VIS_BACKEND_RAY, timing it
+ * for every other strategy
+ *   switch vis to it and time visibility_get over the walk
+ *   reject it if any cell differs from the reference
+ * switch vis to the fastest strategy left
+ */
+visStrategy_t vistune_choose(visibility_t* vis, int cacheSlots, double budget, FILE* fp);
+
+#endif // __VISTUNE_H
@@ -13,6 +13,10 @@
  * David Kotz - May 2019
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE     // for sendmmsg
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -23,6 +27,7 @@
 #include <netdb.h>
 #include <arpa/inet.h>
 #include <sys/select.h>
+#include <sys/socket.h>
 #include <math.h>
 #include "message.h"
 #include "log.h"
@@ -34,6 +39,7 @@
  */
 static const int MinPort = 1024;
 static const int MaxPort = 65535;
+#define SendBatch 64          // most datagrams handed to one sendmmsg()
 
 /**************** file-local global variables ****************/
 /* This is an example of a judicious use of a global variable.
@@ -48,6 +54,13 @@ static const int MaxPort = 65535;
  */
 static int ourSocket = 0;     // socket on which to receive messages
 
+/**************** file-local functions ****************/
+static bool runLoop(void* arg, const float timeout, double (*timeLeft)(void* arg),
+                    bool (*handleTimeout)(void* arg),
+                    bool (*handleInput)  (void* arg),
+                    bool (*handleMessage)(void* arg,
+                                          const addr_t from, const char* buf));
+
 /***********************************************************************/
 /**************** message_init ****************/
 /* 
@@ -263,6 +276,64 @@ message_send(const addr_t to, const char* message)
   }
 }
 
+/**************** message_sendMany ****************/
+/* 
+ * Send one string message to each of several addresses.
+ * See message.h for detailed description.
+ */
+void
+message_sendMany(const addr_t* to, const int count, const char* message)
+{
+  if (ourSocket == 0) {
+    log_v("message_sendMany: called before message_init");
+    return; // error in usage of this function.
+  }
+  if (message == NULL || (to == NULL && count > 0)) {
+    log_v("message_sendMany: called with null message or addresses");
+    return; // error in usage of this function.
+  }
+  size_t length = strlen(message);
+
+#ifdef __linux__
+  // every datagram shares the one buffer; only the address differs
+  struct iovec iov = { (void*) message, length };
+  struct mmsghdr batch[SendBatch];
+  int sent = 0;
+  while (sent < count) {
+    int n = count - sent < SendBatch ? count - sent : SendBatch;
+    memset(batch, 0, n * sizeof(batch[0]));
+    for (int i = 0; i < n; i++) {
+      batch[i].msg_hdr.msg_name = (void*) &to[sent + i];
+      batch[i].msg_hdr.msg_namelen = sizeof(to[sent + i]);
+      batch[i].msg_hdr.msg_iov = &iov;
+      batch[i].msg_hdr.msg_iovlen = 1;
+    }
+    int done = sendmmsg(ourSocket, batch, n, 0);
+    if (done <= 0) {
+      // the first datagram of the batch failed; skip it and go on
+      log_e("message_sendMany: error sending to datagram socket");
+      done = 1;
+    } else {
+      for (int i = 0; i < done; i++) {
+        log_s("message_sendMany: TO %s", message_stringAddr(to[sent + i]));
+      }
+    }
+    sent += done;
+  }
+#else
+  for (int i = 0; i < count; i++) {
+    if (sendto(ourSocket, message, length, 0,
+               (struct sockaddr *) &to[i], sizeof(to[i])) < 0) {
+      log_e("message_sendMany: error sending to datagram socket");
+    } else {
+      log_s("message_sendMany: TO %s", message_stringAddr(to[i]));
+    }
+  }
+#endif
+  log_d("message_sendMany: %d lines:", numLines(message));
+  log_s("%s", message);
+}
+
 /**************** message_loop ****************/
 /* 
  * Loop forever, calling handler functions for stdin or socket,
@@ -276,6 +347,42 @@ message_loop(void* arg, const float timeout,
              bool (*handleInput)  (void* arg),
              bool (*handleMessage)(void* arg,
                                    const addr_t from, const char* buf))
+{
+  return runLoop(arg, timeout, NULL, handleTimeout, handleInput, handleMessage);
+}
+
+/**************** message_loopUntil ****************/
+/* 
+ * Like message_loop, but the caller says before every wait how long
+ * until handleTimeout is due.
+ * See message.h for detailed description.
+ */
+bool
+message_loopUntil(void* arg, double (*timeLeft)(void* arg),
+                  bool (*handleTimeout)(void* arg),
+                  bool (*handleInput)  (void* arg),
+                  bool (*handleMessage)(void* arg,
+                                        const addr_t from, const char* buf))
+{
+  if (timeLeft == NULL || handleTimeout == NULL) {
+    log_v("message_loopUntil called with null timeLeft or handleTimeout");
+    return false; // error in usage of this function.
+  }
+  return runLoop(arg, 0, timeLeft, handleTimeout, handleInput, handleMessage);
+}
+
+/**************** runLoop ****************/
+/* 
+ * The loop behind message_loop and message_loopUntil: the timeout is
+ * the fixed one, or, if timeLeft is not NULL, whatever it says before
+ * each wait (with handleTimeout called at once if that is no time).
+ */
+static bool
+runLoop(void* arg, const float timeout, double (*timeLeft)(void* arg),
+        bool (*handleTimeout)(void* arg),
+        bool (*handleInput)  (void* arg),
+        bool (*handleMessage)(void* arg,
+                              const addr_t from, const char* buf))
 {
   // check if we're ready for messaging
   if (ourSocket == 0) {
@@ -292,7 +399,7 @@ message_loop(void* arg, const float timeout,
     log_v("message_loop called with null handleTimeout but timeout > 0");
     return false; // error in usage of this function.
   }
-  if (handleTimeout != NULL && timeout <= 0.0) {
+  if (handleTimeout != NULL && timeLeft == NULL && timeout <= 0.0) {
     log_v("message_loop called with Timeout handler but timeout <= 0");
     return false; // error in usage of this function.
   }
@@ -303,7 +410,7 @@ message_loop(void* arg, const float timeout,
   struct timeval  timeoutval;     // timeval equivalent of parameter 'timeout'
   if (timeout > 0.0) {
     timeoutval.tv_sec  = (int)timeout;
-    timeoutval.tv_usec = timeout - (int)timeout;
+    timeoutval.tv_usec = (timeout - (int)timeout) * 1000000;
   }
 
   // loop until error or some handler indicates time to quit looping
@@ -322,7 +429,19 @@ message_loop(void* arg, const float timeout,
       FD_SET(ourSocket, &rfds); // monitor the socket
       nfds = ourSocket+1;       // highest-numbered fd in rfds
     }
-    if (timeout > 0.0) {      // is timeout desired?
+    if (timeLeft != NULL) {   // is a deadline coming up?
+      double left = (*timeLeft)(arg);
+      if (left <= 0) {
+        // already due: do not let a busy socket put it off
+        if ((*handleTimeout)(arg)) {
+          break; // handler says to exit loop
+        }
+        continue;
+      }
+      timer.tv_sec  = (long)left;
+      timer.tv_usec = (left - (long)left) * 1000000;
+      timerp = &timer;
+    } else if (timeout > 0.0) {      // is timeout desired?
       timer = timeoutval;     // set the timer to the timeout value
       timerp = &timer;        // pass that timer to select
     } else {
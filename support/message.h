@@ -133,6 +133,23 @@ const char* message_stringAddr(const addr_t addr);
  */
 void message_send(const addr_t to, const char* message);
 
+/******************************************/
+/* message_sendMany: send one message to several addresses.
+ * Caller provides:
+ *   an array of count valid addresses,
+ *   a string containing the message.
+ * Function returns: none
+ * Assumptions: message_init() has already been called.
+ * Notes:
+ *   the same as message_send to each address in turn, but the message is
+ *   measured once and, on Linux, handed to the kernel in one sendmmsg()
+ *   call for up to 64 addresses at a time.
+ * Logs:
+ *   errors in arguments,
+ *   errors in sending the message.
+ */
+void message_sendMany(const addr_t* to, const int count, const char* message);
+
 /******************************************/
 /* message_loop: loop, handling input and incoming messages.
  * Caller provides:
@@ -166,6 +183,28 @@ bool message_loop(void* arg, const float timeout,
                                         const addr_t from, 
                                         const char* message));
 
+/******************************************/
+/* message_loopUntil: like message_loop, but with a moving deadline.
+ * Caller provides:
+ *   a pointer for an arg (may be NULL), passed to the handler functions,
+ *   a function returning the seconds until handleTimeout is next due,
+ *   a function for handling a timeout,
+ *   a function for handling input from stdin (may be NULL),
+ *   a function for handling an inbound message (may be NULL).
+ * Function returns: as message_loop.
+ * Notes:
+ *   timeLeft is asked before every wait, so the wait ends at the deadline
+ *   however many messages came in meanwhile; if it returns 0 or less,
+ *   handleTimeout is called at once, before any more input is read.
+ *   handleTimeout should then move the deadline on, or the loop spins.
+ */
+bool message_loopUntil(void* arg, double (*timeLeft)(void* arg),
+                       bool (*handleTimeout)(void* arg),
+                       bool (*handleInput)  (void* arg),
+                       bool (*handleMessage)(void* arg,
+                                             const addr_t from, 
+                                             const char* message));
+
 /******************************************/
 /* message_done: shut down the module.
  * Caller provides: nothing.